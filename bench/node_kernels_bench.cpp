@@ -0,0 +1,153 @@
+//
+// Created by Luis Ruisinger on 10.11.24.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "../core/level/chunk_data_structure/node_kernels.h"
+#include "../util/culling.h"
+
+using namespace core::level;
+
+#define BENCH_BLOCKS 4096
+#define BENCH_FACES  4096
+#define BENCH_ROUNDS 200
+#define BENCH_SWEEPS 16
+
+/** @brief Keeps the results of the timed loops alive */
+static volatile u64 sink = 0;
+
+/** @brief Nanoseconds per call of fun, averaged over rounds * calls */
+template <typename F>
+static auto measure(u32 calls, F &&fun) -> f64 {
+    fun();
+
+    const auto start = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < BENCH_ROUNDS; ++i)
+        fun();
+
+    const std::chrono::duration<f64, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / (static_cast<f64>(BENCH_ROUNDS) * calls);
+}
+
+/** @brief Rows of a segment and its cullers as Occupancy::expose reads them */
+struct Volume {
+    chunk::Occupancy::Rows occupancy;
+    chunk::Occupancy::Padded cullers;
+    chunk::Occupancy::Rows x_neg;
+    chunk::Occupancy::Rows x_pos;
+};
+
+/** @brief Times every kernel of a table, the kernels are called directly like inside the tree */
+template <const node_kernels::Kernels &K>
+static auto run(
+        const std::vector<node::NodePool::Block> &blocks,
+        const std::vector<u64> &faces,
+        const Volume &volume,
+        const util::culling::Frustum &frustum,
+        const std::vector<util::culling::Spheres> &spheres)
+        -> void {
+    const f64 combinable = measure(blocks.size(), [&]() -> void {
+        u64 count = 0;
+        for (const auto &block : blocks)
+            count += K.check_combinable(block);
+
+        sink = sink + count;
+    });
+
+    const f64 combine = measure(blocks.size(), [&]() -> void {
+        u64 sum = 0;
+        for (const auto &block : blocks)
+            sum |= K.combine_faces(block);
+
+        sink = sink + sum;
+    });
+
+    const VERTEX mesh = {};
+    std::vector<VERTEX> out(faces.size());
+
+    const f64 emit = measure(faces.size(), [&]() -> void {
+        K.emit_faces(mesh, 0, faces.data(), faces.size(), out.data());
+        sink = sink + out.back().vertices[0];
+    });
+
+    auto exposed = std::make_unique<std::array<chunk::Occupancy::Rows, 6>>();
+    const f64 expose = measure(BENCH_SWEEPS, [&]() -> void {
+        for (u32 i = 0; i < BENCH_SWEEPS; ++i)
+            K.expose(volume.occupancy, volume.cullers, volume.x_neg, volume.x_pos, *exposed);
+
+        sink = sink + (*exposed)[0][0];
+    });
+
+    // the frustum kernels are chosen by the same instruction set
+    const auto &culling = util::culling::select(K.isa);
+    const f64 classify = measure(spheres.size(), [&]() -> void {
+        u64 outside = 0;
+        for (const auto &group : spheres)
+            outside += culling.spheres_visible_type(frustum, group).outside;
+
+        sink = sink + outside;
+    });
+
+    std::printf("%-8s check_combinable %6.2f ns  combine_faces %6.2f ns  emit_faces %6.2f ns/face  "
+                "expose %8.1f ns/segment  spheres_visible_type %6.2f ns\n",
+                util::cpu::name(K.isa), combinable, combine, emit, expose, classify);
+}
+
+auto main() -> int {
+    std::mt19937_64 rng(13);
+
+    // every other block is combinable, the branch of check_combinable is not predictable
+    std::vector<node::NodePool::Block> blocks(BENCH_BLOCKS);
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        const u64 base = rng() & ~(static_cast<u64>(0xFF) << 0x38);
+
+        for (auto &child : blocks[i])
+            child.packed_data = (rng() & 0x1) ? base : rng();
+    }
+
+    std::vector<u64> faces(BENCH_FACES);
+    for (auto &face : faces)
+        face = rng();
+
+    auto volume = std::make_unique<Volume>();
+    for (auto *rows : { &volume->occupancy, &volume->x_neg, &volume->x_pos })
+        for (auto &row : *rows)
+            row = static_cast<u32>(rng());
+
+    for (auto &row : volume->cullers)
+        row = static_cast<u32>(rng());
+
+    // camera at the origin looking along +z, the spheres surround it
+    util::culling::Frustum frustum;
+    frustum.set_cam_internals(45.0F, 16.0F / 9.0F, 0.1F, 256.0F);
+    frustum.set_cam_definition(glm::vec3 { 0.0F }, glm::vec3 { 0.0F, 0.0F, 1.0F }, glm::vec3 { 0.0F, 1.0F, 0.0F });
+
+    std::uniform_real_distribution<f32> position(-256.0F, 256.0F);
+    std::vector<util::culling::Spheres> spheres(BENCH_BLOCKS);
+    for (auto &group : spheres)
+        for (u8 i = 0; i < 8; ++i) {
+            group.x[i] = position(rng);
+            group.y[i] = position(rng);
+            group.z[i] = position(rng);
+            group.radius[i] = static_cast<f32>(CHUNK_SIZE) * SQRT_2;
+        }
+
+    run<node_kernels::scalar_kernels>(blocks, faces, *volume, frustum, spheres);
+
+#ifdef CPU_DISPATCH
+    const auto detected = util::cpu::detect();
+
+    if (detected >= util::cpu::AVX2)
+        run<node_kernels::avx2_kernels>(blocks, faces, *volume, frustum, spheres);
+
+    if (detected >= util::cpu::AVX512)
+        run<node_kernels::avx512_kernels>(blocks, faces, *volume, frustum, spheres);
+#endif
+
+    return 0;
+}
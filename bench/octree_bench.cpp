@@ -0,0 +1,279 @@
+//
+// Created by Luis Ruisinger on 10.11.24.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "../core/level/chunk_data_structure/octree.h"
+
+using namespace core::level;
+
+#define BENCH_TREES  64
+#define BENCH_ROUNDS 5
+
+/**
+ * @brief Layout before the node pool, every inner node owns its children through a heap allocation.
+ *        Insert and recombine are copies of the scalar paths before the pool, the leaf traversal
+ *        collects the same faces as Node::stream. The pool side additionally keeps the
+ *        representative voxelIDs and counts the visible faces while recombining.
+ */
+namespace legacy {
+    struct Node {
+        std::unique_ptr<std::array<Node, 8>> nodes {};
+        u64 packed_data { 0 };
+    };
+
+    static auto insert(u64 packed_voxel, u32 data, Node *current) -> void {
+        for (;;) {
+            if ((0x1 << (data & MASK_3)) == BASE_SIZE) {
+                current->packed_data =
+                        (static_cast<u64>(MASK_6) << 0x32) |
+                        (static_cast<u64>(data) << SHIFT_HIGH) |
+                        (packed_voxel & UINT32_MAX);
+                return;
+            }
+
+            const u8 index    = node_inline::select_child(packed_voxel >> SHIFT_HIGH, data);
+            const u8 segment  = 1 << index;
+            const u8 segments = current->packed_data >> 0x38;
+
+            if (!segments) {
+                current->nodes = std::make_unique<std::array<Node, 8>>();
+                current->packed_data =
+                        (static_cast<u64>(segment) << 0x38) |
+                        (static_cast<u64>(data) << SHIFT_HIGH) |
+                        (packed_voxel & 0xFFFF0000);
+            }
+
+            if (!(segments & segment))
+                current->packed_data |=
+                        (static_cast<u64>(segment) << 0x38) |
+                        (static_cast<u64>(MASK_6) << 0x32);
+
+            data = node_inline::build_AABB(index, data);
+            current = &(*current->nodes)[index];
+        }
+    }
+
+    static auto check_combinable(Node *node) -> bool {
+
+        // all children must be in use
+        if ((node->packed_data >> 0x38) ^ 0xFF)
+            return false;
+
+        for (const auto &child : *node->nodes) {
+            if (child.packed_data >> 0x38)
+                return false;
+        }
+
+        const auto &first = (*node->nodes)[0];
+        for (const auto &child : *node->nodes) {
+            if (((child.packed_data >> SHIFT_HIGH) & MASK_3) !=
+                ((first.packed_data >> SHIFT_HIGH) & MASK_3)) {
+                return false;
+            }
+        }
+
+        for (const auto &child : *node->nodes) {
+            if ((child.packed_data & MASK_VOXEL_ID) !=
+                (first.packed_data & MASK_VOXEL_ID)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    static auto combine_faces(Node *node) -> u64 {
+        static constexpr const u64 mask = static_cast<u64>(MASK_6) << 0x32;
+
+        u64 sum = 0;
+        for (const auto &child : *node->nodes)
+            sum |= child.packed_data;
+
+        return sum & mask;
+    }
+
+    static auto recombine(Node *node) -> void {
+        u8 segments = node->packed_data >> 56;
+
+        if (!(segments & (segments - 1))) {
+            for (u8 i = 0; i < 8; ++i)
+                if (segments & (1 << i)) {
+                    node->packed_data = node->nodes->operator[](i).packed_data;
+                    node->nodes = std::move(node->nodes->operator[](i).nodes);
+
+                    segments = node->packed_data >> 56;
+                    break;
+                }
+        }
+
+        for (u8 i = 0; i < 8; ++i)
+            if (segments & (1 << i))
+                recombine(&node->nodes->operator[](i));
+
+        if (!check_combinable(node))
+            return;
+
+        node->packed_data &= (UINT64_MAX >> 14) & (UINT64_MAX << 9);
+        node->packed_data |= combine_faces(node);
+        node->packed_data |= node->nodes->operator[](0).packed_data & MASK_VOXEL_ID;
+
+        node->nodes = {};
+    }
+
+    static auto stream(const Node &node, std::array<std::vector<u64>, 6> &faces) -> void {
+        const u8 mask = (node.packed_data >> 0x32) & MASK_6;
+        if (!mask)
+            return;
+
+        const u8 segments = node.packed_data >> 0x38;
+        if (segments) {
+            for (u8 i = 0; i < 8; ++i)
+                if (segments & (1 << i))
+                    stream((*node.nodes)[i], faces);
+
+            return;
+        }
+
+        for (u8 i = 0; i < 6; ++i)
+            if (mask & (1 << i))
+                faces[i].push_back(node.packed_data);
+    }
+}
+
+/** @brief Voxels of a segment of rolling terrain with caves, two voxelIDs split by depth */
+static auto terrain(std::mt19937 &rng) -> std::vector<u64> {
+    std::vector<u64> voxels;
+
+    const i32 base = static_cast<i32>(rng() % 16) + 8;
+    for (u32 x = 0; x < CHUNK_SIZE; ++x)
+        for (u32 z = 0; z < CHUNK_SIZE; ++z) {
+            const i32 height = base + static_cast<i32>((x / 4 + z / 8) % 6) + static_cast<i32>(rng() % 2);
+
+            for (u32 y = 0; y < static_cast<u32>(height) && y < CHUNK_SIZE; ++y) {
+                if (!(rng() % 13))
+                    continue;
+
+                const u32 high = (x << 13) | (y << 8) | (z << 3) | MASK_3;
+                const u32 low  = static_cast<i32>(y) + 4 < height ? 1 : 2;
+                voxels.push_back((static_cast<u64>(high) << SHIFT_HIGH) | low);
+            }
+        }
+
+    return voxels;
+}
+
+/** @brief Milliseconds spent inside fun */
+template <typename F>
+static auto measure(F &&fun) -> f64 {
+    const auto start = std::chrono::steady_clock::now();
+    fun();
+
+    const std::chrono::duration<f64, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+auto main() -> int {
+    std::mt19937 rng(17);
+
+    std::vector<std::vector<u64>> segments;
+    size_t voxels = 0;
+
+    for (i32 i = 0; i < BENCH_TREES; ++i) {
+        segments.push_back(terrain(rng));
+        voxels += segments.back().size();
+    }
+
+    // root of a tree, see Octree::_packed
+    const u32 root = (0x3F << 18) | (0x10 << 13) | (0x10 << 8) | (0x10 << 3) | 5;
+
+    f64 insert[2] {}, recombine[2] {}, compact = 0.0, stream[2] {};
+    size_t faces[2] {};
+
+    for (i32 round = 0; round < BENCH_ROUNDS; ++round) {
+        std::vector<legacy::Node> old_trees(BENCH_TREES);
+        std::vector<std::unique_ptr<octree::Octree>> trees;
+
+        for (i32 i = 0; i < BENCH_TREES; ++i)
+            trees.push_back(std::make_unique<octree::Octree>());
+
+        insert[0] += measure([&]() -> void {
+            for (i32 i = 0; i < BENCH_TREES; ++i)
+                for (const u64 voxel : segments[i])
+                    legacy::insert(voxel, root, &old_trees[i]);
+        });
+
+        insert[1] += measure([&]() -> void {
+            for (i32 i = 0; i < BENCH_TREES; ++i)
+                for (const u64 voxel : segments[i])
+                    trees[i]->addPoint(voxel);
+        });
+
+        recombine[0] += measure([&]() -> void {
+            for (auto &tree : old_trees)
+                legacy::recombine(&tree);
+        });
+
+        recombine[1] += measure([&]() -> void {
+            for (auto &tree : trees)
+                tree->recombine();
+        });
+
+        // the pointer layout has nothing to relayout, its blocks are freed on the way
+        compact += measure([&]() -> void {
+            for (auto &tree : trees)
+                tree->compact();
+        });
+
+        // a leaf emits at most one face per direction, neither layout grows the streams while timed
+        std::array<std::vector<u64>, 6> streams;
+        for (auto &face : streams)
+            face.reserve(voxels);
+
+        auto count = [&streams]() -> size_t {
+            size_t sum = 0;
+            for (auto &face : streams) {
+                sum += face.size();
+                face.clear();
+            }
+
+            return sum;
+        };
+
+        stream[0] += measure([&]() -> void {
+            for (const auto &tree : old_trees)
+                legacy::stream(tree, streams);
+        });
+
+        faces[0] = count();
+
+        stream[1] += measure([&]() -> void {
+            for (const auto &tree : trees)
+                tree->stream(streams);
+        });
+
+        faces[1] = count();
+    }
+
+    // both layouts have to do the same work
+    if (faces[0] != faces[1]) {
+        std::fprintf(stderr, "faces differ, pointer %zu pool %zu\n", faces[0], faces[1]);
+        return 1;
+    }
+
+    const f64 rounds = BENCH_ROUNDS;
+    std::printf("%d trees, %zu voxels, %zu faces, %s kernels\n",
+                BENCH_TREES, voxels, faces[0], util::cpu::name(node_kernels::kernels.isa));
+
+    std::printf("%-10s %12s %12s\n", "", "pointer", "pool");
+    std::printf("%-10s %9.2f ms %9.2f ms\n", "insert",    insert[0] / rounds,    insert[1] / rounds);
+    std::printf("%-10s %9.2f ms %9.2f ms\n", "recombine", recombine[0] / rounds, recombine[1] / rounds);
+    std::printf("%-10s %12s %9.2f ms\n", "compact",   "-",                   compact / rounds);
+    std::printf("%-10s %9.2f ms %9.2f ms\n", "stream",    stream[0] / rounds,    stream[1] / rounds);
+    return 0;
+}
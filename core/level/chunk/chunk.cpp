@@ -5,10 +5,16 @@
 #define GLM_FORCE_AVX
 #endif
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 #include "chunk.h"
 #include "chunk_renderer.h"
+#include "greedy_faces.h"
 #include "generation/generation.h"
 
+#include "../chunk_data_structure/node_kernels.h"
 #include "../chunk_data_structure/voxel_data_layout.h"
 
 #include "../util/assert.h"
@@ -17,112 +23,380 @@
 namespace core::level::chunk {
     using rendering::renderer::RenderType;
 
-    auto OcclusionMap::operator[](u64 mask) -> std::unordered_map<node::Node *, u32> & {
-        switch (mask) {
-            case TOP_BIT   : return this->map[0];
-            case BOTTOM_BIT: return this->map[1];
-            case FRONT_BIT : return this->map[2];
-            case BACK_BIT  : return this->map[3];
-            case LEFT_BIT  : return this->map[4];
-            case RIGHT_BIT : return this->map[5];
+    /** @brief Side of a neighbor facing back to the chunk, indexed by Position */
+    static constexpr const Position opposite[4] = {
+            Position::RIGHT, Position::LEFT, Position::BACK, Position::FRONT
+    };
+
+    /**
+     * @brief  Checks if a tile hides less than the default tile of its tree. Voxel tiles hide
+     *         every tile that can be culled by them, water tiles only hide themselves.
+     * @param  voxel_ID The tile of the voxel.
+     * @param  water    Selects the water tree.
+     * @return Boolean indicating if the voxel is left out of the cullers of finalize_faces.
+     */
+    static auto translucent(u16 voxel_ID, bool water) -> bool {
+        const auto flags = tiles::tile_manager::tile_manager[voxel_ID & 0x1FF].flags;
+        const u8 hides = water ? tiles::tile::can_cull_itself : tiles::tile::can_cull_other | tiles::tile::can_cull_itself;
+
+        return (flags & hides) != hides;
+    }
+
+    /**
+     * @brief  Key of a face of a node, stable while the tree is recombined or relocated.
+     * @param  face        The non-shifted face bit.
+     * @param  packed_data The packed data of the node owning the face.
+     * @param  placement   The chunk and segment of the node, see OcclusionCounters::placement.
+     * @return Non-zero key.
+     */
+    auto OcclusionCounters::key(u64 face, u64 packed_data, u8 placement) -> u64 {
+        return (static_cast<u64>(0x1) << 0x28) |
+               (static_cast<u64>(placement) << 0x18) |
+               (static_cast<u64>(std::countr_zero(face >> 50)) << 0x12) |
+               ((packed_data >> SHIFT_HIGH) & node_inline::mask_coords);
+    }
+
+    /**
+     * @brief  Placement of a position relative to the chunk counting, nodes do not carry it.
+     * @param  position Position relative to the chunk, may lie inside a direct neighbor.
+     * @return Offset of the chunk (0 to 2 along x and z) and the segment.
+     */
+    auto OcclusionCounters::placement(glm::ivec3 position) -> u8 {
+        const u8 x = position.x < 0 ? 0 : (position.x < CHUNK_SIZE ? 1 : 2);
+        const u8 z = position.z < 0 ? 0 : (position.z < CHUNK_SIZE ? 1 : 2);
+
+        return (x << 6) | (z << 4) | (CHUNK_SEGMENT_Y_DIFF(position) & 0xF);
+    }
+
+    /**
+     * @brief  Counter of a key, inserted with 0 if missing.
+     * @param  key Key built by OcclusionCounters::key.
+     * @return Reference to the counter, valid until the next insertion.
+     */
+    auto OcclusionCounters::operator[](u64 key) -> u32 & {
+
+        // keeping the load factor below 0.5 bounds the probe length
+        if ((this->used + 1) * 2 > this->slots.size())
+            grow();
+
+        const size_t mask = this->slots.size() - 1;
+        for (size_t i = slot(key);; i = (i + 1) & mask) {
+            auto &[k, count] = this->slots[i];
+
+            if (k == key)
+                return count;
+
+            if (!k) {
+                k = key;
+                ++this->used;
+                return count;
+            }
         }
+    }
 
-#if defined(__GNUC__)
-        __builtin_unreachable();
-#elif defined(_MSC_VER)
-        __assume(false);
-#endif
+    /**
+     * @brief  Counter of a key without inserting it.
+     * @param  key Key built by OcclusionCounters::key.
+     * @return Pointer to the counter or nullptr.
+     */
+    auto OcclusionCounters::find(u64 key) -> u32 * {
+        if (this->slots.empty())
+            return nullptr;
+
+        const size_t mask = this->slots.size() - 1;
+        for (size_t i = slot(key);; i = (i + 1) & mask) {
+            auto &[k, count] = this->slots[i];
+
+            if (k == key)
+                return &count;
+
+            if (!k)
+                return nullptr;
+        }
     }
 
-    Chunk::Chunk(u16 chunk_idx)
+    auto OcclusionCounters::grow() -> void {
+        auto old = std::move(this->slots);
+        this->slots = std::vector<std::pair<u64, u32>>(std::max<size_t>(old.size() * 2, 64));
+        this->used = 0;
+
+        for (const auto &[k, count] : old)
+            if (k)
+                (*this)[k] = count;
+    }
+
+    auto OcclusionCounters::slot(u64 key) const -> size_t {
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15) >> 0x20) & (this->slots.size() - 1);
+    }
+
+    Chunk::Chunk(u16 chunk_idx, glm::ivec2 coordinates)
             : chunk_idx { static_cast<u16>(chunk_idx & 0xFFF) }
     {
-        this->chunk_pos = {
-                static_cast<int>((this->chunk_idx % (RENDER_RADIUS * 2)) - RENDER_RADIUS),
-                0,
-                static_cast<int>((this->chunk_idx / (RENDER_RADIUS * 2)) - RENDER_RADIUS)
-        };
-
-        this->chunk_pos *= static_cast<f32>(CHUNK_SIZE);
+        this->chunk_pos = glm::ivec3 { coordinates.x, 0, coordinates.y } * CHUNK_SIZE;
 
         for (u8 i = 0; i < CHUNK_SEGMENTS; ++i)
             this->chunk_segments.emplace_back(i);
     }
 
-    auto Chunk::generate(glm::ivec2 root) -> void {
-        auto offset = root + glm::ivec2(this->chunk_pos.x, this->chunk_pos.z);
+    /**
+     * @brief Generates the voxels of the chunk and builds the trees of all segments.
+     *        Every tree is built by its own sub-task, the last one to finish resolves the faces.
+     * @param pool Pool running the sub-tasks.
+     */
+    auto Chunk::generate(threading::thread_pool::Tasksystem<> &pool) -> void {
+        auto offset = glm::ivec2(this->chunk_pos.x, this->chunk_pos.z);
+
+        this->staging = std::make_unique<Staging>();
         generation::generation::Generator::generate(*this, offset);
 
-        for (size_t i = 0; i < chunk_segments.size(); ++i) {
-            this->faces |= this->chunk_segments[i]
-                    .voxel_root->updateFaceMask((this->chunk_idx << 4) | i);
+        // restored trees replace the generated ones, see Chunk::serialize for the layout
+        for (size_t at = 0; at + 1 + sizeof(u32) <= this->edits.size();) {
+            const u8 tree = this->edits[at];
+
+            u32 size;
+            std::memcpy(&size, this->edits.data() + at + 1, sizeof(u32));
+            at += 1 + sizeof(u32);
+
+            if (tree >= CHUNK_TREES || size > this->edits.size() - at)
+                break;
+
+            this->staging->edits[tree] = std::span<const u8> { this->edits.data() + at, size };
+            at += size;
+        }
+
+        this->pending_trees.store(CHUNK_TREES, std::memory_order_relaxed);
+        for (u8 tree = 0; tree < CHUNK_TREES; ++tree) {
+            pool.enqueue_detach([this, tree]() -> void {
+                build_staged(tree);
 
-            this->faces |= this->chunk_segments[i]
-                    .water_root->updateFaceMask((this->chunk_idx << 4) | i);
+                if (this->pending_trees.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    finish_generation();
+            });
         }
     }
 
+    auto Chunk::finish_generation() -> void {
+        this->staging.reset();
+        this->edits = std::vector<u8> {};
+
+        // the occupancy is complete, neighbors may resolve their seams against it
+        this->generated.store(true, std::memory_order_release);
+        finalize_faces();
+
+        // the job is complete, the chunk may be handed to the next one
+        this->resolved.store(true, std::memory_order_release);
+    }
+
+    /**
+     * @brief  Writable voxel at a position, copies a tree still shared with its snapshot.
+     *         Positions outside of the chunk are not resolved, the trees of a neighbor are
+     *         only written by its own jobs.
+     * @param  position The position of the voxel.
+     * @return The enclosing leaf or nullptr.
+     */
     auto Chunk::find(glm::ivec3 position) -> node::Node * {
+        const auto segment_idx = CHUNK_SEGMENT_Y_DIFF(position);
+        if (segment_idx < 0 || segment_idx >= CHUNK_SEGMENTS)
+            return nullptr;
+
+        // intra-chunk-finding
+        if ((position.x >= 0 && position.x < CHUNK_SIZE) &&
+            (position.z >= 0 && position.z < CHUNK_SIZE)) {
+            auto normalized_vec = CHUNK_SEGMENT_Y_NORMALIZE(position);
+            auto &segment = this->chunk_segments[segment_idx];
+
+            u64 x = static_cast<u8>(normalized_vec.x) & MASK_5;
+            u64 y = static_cast<u8>(normalized_vec.y) & MASK_5;
+            u64 z = static_cast<u8>(normalized_vec.z) & MASK_5;
 
-        // inter-chunk-finding
+            // empty positions are answered by the occupancy without walking a tree
+            u32 mask = (x << 13) | (y << 8) | (z << 3) | MASK_3;
+            if (segment.voxel_occupancy.test(x, y, z))
+                return segment.tree(false).find(mask);
+
+            if (segment.water_occupancy.test(x, y, z))
+                return segment.tree(true).find(mask);
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * @brief  Packed data of the voxel at a position, no tree is copied for the read.
+     *         Positions outside of the chunk are forwarded to the respective neighbor,
+     *         which is read through its published snapshots since its own jobs may
+     *         write its working trees meanwhile.
+     * @param  position  The position of the voxel.
+     * @param  published Reads the published snapshots instead of the working trees.
+     * @return The packed data of the enclosing leaf, 0 if the position is empty.
+     */
+    auto Chunk::lookup(glm::ivec3 position, bool published) const -> u64 {
+
+        // inter-chunk-lookup
         if (position.x >= CHUNK_SIZE) {
-            for (const auto &[p, w] : this->neighbors)
-                if (p == Position::FRONT) {
-                    if (auto ptr = w.lock()) {
-                        position.x -= CHUNK_SIZE;
-                        ASSERT_EQ(ptr.get());
-                        return ptr->find(position);
-                    }
-                }
+            if (const auto *ptr = this->neighbors[Position::FRONT]) {
+                position.x -= CHUNK_SIZE;
+                return ptr->lookup(position, true);
+            }
         }
-        else if (position.x < 0.0F) {
-            for (const auto &[p, w] : this->neighbors)
-                if (p == Position::BACK) {
-                    if (auto ptr = w.lock()) {
-                        position.x += CHUNK_SIZE;
-                        ASSERT_EQ(ptr.get());
-                        return ptr->find(position);
-                    }
-                }
+        else if (position.x < 0) {
+            if (const auto *ptr = this->neighbors[Position::BACK]) {
+                position.x += CHUNK_SIZE;
+                return ptr->lookup(position, true);
+            }
         }
         else if (position.z >= CHUNK_SIZE) {
-            for (const auto& [p, w] : this->neighbors)
-                if (p == Position::RIGHT) {
-                    if (auto ptr = w.lock()) {
-                        position.z -= CHUNK_SIZE;
-                        ASSERT_EQ(ptr.get());
-                        return ptr->find(position);
-                    }
-                }
+            if (const auto *ptr = this->neighbors[Position::RIGHT]) {
+                position.z -= CHUNK_SIZE;
+                return ptr->lookup(position, true);
+            }
         }
-        else if (position.z < 0.0F) {
-            for (const auto& [p, w] : this->neighbors)
-                if (p == Position::LEFT) {
-                    if (auto ptr = w.lock()) {
-                        position.z += CHUNK_SIZE;
-                        ASSERT_EQ(ptr.get());
-                        return ptr->find(position);
-                    }
-                }
+        else if (position.z < 0) {
+            if (const auto *ptr = this->neighbors[Position::LEFT]) {
+                position.z += CHUNK_SIZE;
+                return ptr->lookup(position, true);
+            }
         }
 
-        // intra-chunk-finding
-        else if ((position.x >= 0 && position.x < CHUNK_SIZE) &&
-                 (position.z >= 0 && position.z < CHUNK_SIZE)) {
+        // intra-chunk-lookup
+        else {
+            const auto segment_idx = CHUNK_SEGMENT_Y_DIFF(position);
+            if (segment_idx < 0 || segment_idx >= CHUNK_SEGMENTS)
+                return 0;
+
             auto normalized_vec = CHUNK_SEGMENT_Y_NORMALIZE(position);
-            auto &segment = this->chunk_segments[CHUNK_SEGMENT_Y_DIFF(position)];
+            const auto &segment = this->chunk_segments[segment_idx];
 
-            u64 x = static_cast<u8>(normalized_vec.x) & MASK_5;
-            u64 y = static_cast<u8>(normalized_vec.y) & MASK_5;
-            u64 z = static_cast<u8>(normalized_vec.z) & MASK_5;
+            u32 x = static_cast<u8>(normalized_vec.x) & MASK_5;
+            u32 y = static_cast<u8>(normalized_vec.y) & MASK_5;
+            u32 z = static_cast<u8>(normalized_vec.z) & MASK_5;
 
             u32 mask = (x << 13) | (y << 8) | (z << 3) | MASK_3;
-            auto *candidate = segment.voxel_root->find(mask);
 
-            return candidate ? candidate : segment.water_root->find(mask);
+            auto read = [&](bool water) -> u64 {
+                if (!published)
+                    return segment.tree(water).lookup(mask);
+
+                const auto tree = segment.snapshot(water);
+                return tree ? tree->lookup(mask) : 0;
+            };
+
+            // empty positions are answered by the occupancy without walking a tree
+            if (segment.voxel_occupancy.test(x, y, z))
+                return read(false);
+
+            if (segment.water_occupancy.test(x, y, z))
+                return read(true);
         }
 
-        return nullptr;
+        return 0;
+    }
+
+    /**
+     * @brief  Point query in O(1) on the occupancy of both trees.
+     *         Positions outside of the chunk are forwarded to the respective neighbor.
+     *         Chunks still generating are reported empty, their occupancy is written meanwhile.
+     * @param  position The position of the voxel.
+     * @param  water    Whether water counts as occupied.
+     * @return Boolean indicating if a voxel exists at the position.
+     */
+    auto Chunk::occupied(glm::ivec3 position, bool water) -> bool {
+
+        // inter-chunk-query
+        if (position.x >= CHUNK_SIZE) {
+            if (auto *ptr = this->neighbors[Position::FRONT]) {
+                position.x -= CHUNK_SIZE;
+                return ptr->occupied(position, water);
+            }
+        }
+        else if (position.x < 0) {
+            if (auto *ptr = this->neighbors[Position::BACK]) {
+                position.x += CHUNK_SIZE;
+                return ptr->occupied(position, water);
+            }
+        }
+        else if (position.z >= CHUNK_SIZE) {
+            if (auto *ptr = this->neighbors[Position::RIGHT]) {
+                position.z -= CHUNK_SIZE;
+                return ptr->occupied(position, water);
+            }
+        }
+        else if (position.z < 0) {
+            if (auto *ptr = this->neighbors[Position::LEFT]) {
+                position.z += CHUNK_SIZE;
+                return ptr->occupied(position, water);
+            }
+        }
+
+        // intra-chunk-query
+        else {
+            const auto segment_idx = CHUNK_SEGMENT_Y_DIFF(position);
+            if (segment_idx < 0 || segment_idx >= CHUNK_SEGMENTS || !is_generated())
+                return false;
+
+            auto normalized_vec = CHUNK_SEGMENT_Y_NORMALIZE(position);
+            const auto &segment = this->chunk_segments[segment_idx];
+
+            u8 x = static_cast<u8>(normalized_vec.x) & MASK_5;
+            u8 y = static_cast<u8>(normalized_vec.y) & MASK_5;
+            u8 z = static_cast<u8>(normalized_vec.z) & MASK_5;
+
+            return segment.voxel_occupancy.test(x, y, z) || (water && segment.water_occupancy.test(x, y, z));
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Visits every leaf of the chunk intersecting a box, only intersecting nodes are descended.
+     *        Recombined volumes are visited once as a whole, even if they exceed the box.
+     *        The published snapshots are queried, edits are visible once published.
+     * @param aabb  Box in chunk coordinates (x and z relative to the chunk, y in world height),
+     *              min inclusive and max exclusive. Anything outside of the chunk is ignored.
+     * @param fun   Receives the volume of every intersecting leaf in chunk coordinates.
+     * @param water Whether the water trees are queried as well.
+     */
+    auto Chunk::query_box(
+            const util::aabb::AABB<i32> &aabb,
+            const std::function<void(const Cube &)> &fun,
+            bool water) const
+            -> void {
+        const i32 first = std::max((aabb.min.y - MIN_HEIGHT) / CHUNK_SIZE, 0);
+        const i32 last  = std::min((aabb.max.y - 1 - MIN_HEIGHT) / CHUNK_SIZE, CHUNK_SEGMENTS - 1);
+
+        for (i32 i = first; i <= last && aabb.max.y > MIN_HEIGHT; ++i) {
+            const auto &segment = this->chunk_segments[i];
+            const i32 base = CHUNK_SEGMENT_YOFFS(i);
+
+            auto local = aabb;
+            local.min.y -= base;
+            local.max.y -= base;
+
+            auto visit = [&](bool is_water) {
+                return [&, is_water](u64 packed_data) -> void {
+                    const u32 high = packed_data >> SHIFT_HIGH;
+                    const i32 exponent = high & MASK_3;
+                    const i32 half = exponent ? (1 << (exponent - 1)) : 0;
+
+                    fun(Cube {
+                            glm::ivec3 {
+                                    static_cast<i32>((high >> 0xD) & MASK_5) - half,
+                                    static_cast<i32>((high >> 0x8) & MASK_5) - half + base,
+                                    static_cast<i32>((high >> 0x3) & MASK_5) - half
+                            },
+                            1 << exponent,
+                            static_cast<u16>(packed_data & MASK_VOXEL_ID),
+                            is_water
+                    });
+                };
+            };
+
+            if (const auto tree = segment.snapshot(false))
+                tree->for_each_in_box(local, visit(false));
+
+            if (const auto tree = water ? segment.snapshot(true) : nullptr)
+                tree->for_each_in_box(local, visit(true));
+        }
     }
 
     template <>
@@ -140,28 +414,40 @@ namespace core::level::chunk {
         // setting coordinates
         u32 packed_data_highp = (x << 13) | (y <<  8) | (z <<  3) | MASK_3;
 
-        // 12 highest bit set to the index of the chunk inside chunk managing array
-        u32 packed_data_lowp =
-                (this->chunk_idx << 20) |
-                (segment.segment_idx << 16) |
-                (voxel_ID & 0x1FF);
+        // the placement of the chunk is added once the faces are emitted
+        u32 packed_data_lowp = voxel_ID & 0x1FF;
 
-        auto *node = segment.voxel_root->addPoint(
+        auto *node = segment.tree(false).addPoint(
                 (static_cast<u64>(packed_data_highp) << SHIFT_HIGH) | packed_data_lowp);
+        segment.voxel_occupancy.set(x, y, z);
+
+        if (translucent(voxel_ID, false))
+            segment.voxel_translucent.set(x, y, z);
+        else
+            segment.voxel_translucent.reset(x, y, z);
 
         f32 offset = 1 << ((node->packed_data >> SHIFT_HIGH) & MASK_3);
 
         // occlusion culling
-        update_occlusion(node, find(position - glm::ivec3 {1, 0, 0}), LEFT_BIT, RIGHT_BIT);
-        update_occlusion(node, find(position + glm::ivec3 {1, 0, 0}), RIGHT_BIT, LEFT_BIT);
-        update_occlusion(node, find(position - glm::ivec3 {0, 1, 0}), BOTTOM_BIT, TOP_BIT);
-        update_occlusion(node, find(position + glm::ivec3 {0, 1, 0}), TOP_BIT, BOTTOM_BIT);
-        update_occlusion(node, find(position - glm::ivec3 {0, 0, 1}), BACK_BIT, FRONT_BIT);
-        update_occlusion(node, find(position + glm::ivec3 {0, 0, 1}), FRONT_BIT, BACK_BIT);
+        update_occlusion(node, position - glm::ivec3 {1, 0, 0}, LEFT_BIT, RIGHT_BIT);
+        update_occlusion(node, position + glm::ivec3 {1, 0, 0}, RIGHT_BIT, LEFT_BIT);
+        update_occlusion(node, position - glm::ivec3 {0, 1, 0}, BOTTOM_BIT, TOP_BIT);
+        update_occlusion(node, position + glm::ivec3 {0, 1, 0}, TOP_BIT, BOTTOM_BIT);
+        update_occlusion(node, position - glm::ivec3 {0, 0, 1}, BACK_BIT, FRONT_BIT);
+        update_occlusion(node, position + glm::ivec3 {0, 0, 1}, FRONT_BIT, BACK_BIT);
+
+        // occluded neighbors may lie in other segments
+        segment.stream_dirty = true;
+        invalidate(position - glm::ivec3 {1, 0, 0});
+        invalidate(position + glm::ivec3 {1, 0, 0});
+        invalidate(position - glm::ivec3 {0, 1, 0});
+        invalidate(position + glm::ivec3 {0, 1, 0});
+        invalidate(position - glm::ivec3 {0, 0, 1});
+        invalidate(position + glm::ivec3 {0, 0, 1});
 
         // recombining voxels
         if (recombine) {
-            segment.voxel_root->recombine();
+            segment.tree(false).recombine();
             segment.chunk_modified = true;
         }
     }
@@ -181,43 +467,384 @@ namespace core::level::chunk {
         // setting coordinates
         u32 packed_data_highp = (x << 13) | (y <<  8) | (z <<  3) | MASK_3;
 
-        // 12 highest bit set to the index of the chunk inside chunk managing array
-        u32 packed_data_lowp =
-                (this->chunk_idx << 20) |
-                (segment.segment_idx << 16) |
-                (voxel_ID & 0x1FF);
+        // the placement of the chunk is added once the faces are emitted
+        u32 packed_data_lowp = voxel_ID & 0x1FF;
 
-        auto *node = segment.water_root->addPoint(
+        auto *node = segment.tree(true).addPoint(
                 (static_cast<u64>(packed_data_highp) << SHIFT_HIGH) | packed_data_lowp);
+        segment.water_occupancy.set(x, y, z);
+
+        if (translucent(voxel_ID, true))
+            segment.water_translucent.set(x, y, z);
+        else
+            segment.water_translucent.reset(x, y, z);
 
         f32 offset = 1 << ((node->packed_data >> SHIFT_HIGH) & MASK_3);
 
         // occlusion culling
-        update_occlusion(node, find(position - glm::ivec3 {1, 0, 0}), LEFT_BIT, RIGHT_BIT);
-        update_occlusion(node, find(position + glm::ivec3 {1, 0, 0}), RIGHT_BIT, LEFT_BIT);
-        update_occlusion(node, find(position - glm::ivec3 {0, 1, 0}), BOTTOM_BIT, TOP_BIT);
-        update_occlusion(node, find(position + glm::ivec3 {0, 1, 0}), TOP_BIT, BOTTOM_BIT);
-        update_occlusion(node, find(position - glm::ivec3 {0, 0, 1}), BACK_BIT, FRONT_BIT);
-        update_occlusion(node, find(position + glm::ivec3 {0, 0, 1}), FRONT_BIT, BACK_BIT);
+        update_occlusion(node, position - glm::ivec3 {1, 0, 0}, LEFT_BIT, RIGHT_BIT);
+        update_occlusion(node, position + glm::ivec3 {1, 0, 0}, RIGHT_BIT, LEFT_BIT);
+        update_occlusion(node, position - glm::ivec3 {0, 1, 0}, BOTTOM_BIT, TOP_BIT);
+        update_occlusion(node, position + glm::ivec3 {0, 1, 0}, TOP_BIT, BOTTOM_BIT);
+        update_occlusion(node, position - glm::ivec3 {0, 0, 1}, BACK_BIT, FRONT_BIT);
+        update_occlusion(node, position + glm::ivec3 {0, 0, 1}, FRONT_BIT, BACK_BIT);
+
+        // occluded neighbors may lie in other segments
+        segment.stream_dirty = true;
+        invalidate(position - glm::ivec3 {1, 0, 0});
+        invalidate(position + glm::ivec3 {1, 0, 0});
+        invalidate(position - glm::ivec3 {0, 1, 0});
+        invalidate(position + glm::ivec3 {0, 1, 0});
+        invalidate(position - glm::ivec3 {0, 0, 1});
+        invalidate(position + glm::ivec3 {0, 0, 1});
 
         // recombining voxels
         if (recombine) {
-            segment.water_root->recombine();
+            segment.tree(true).recombine();
             segment.chunk_modified = true;
         }
     }
 
+    template <>
+    auto Chunk::fill<RenderType::CHUNK_RENDERER>(
+            const util::aabb::AABB<i32> &aabb,
+            u16 voxel_ID) -> void {
+        fill_box(aabb, voxel_ID, false);
+    }
+
+    template <>
+    auto Chunk::fill<RenderType::WATER_RENDERER>(
+            const util::aabb::AABB<i32> &aabb,
+            u16 voxel_ID) -> void {
+        fill_box(aabb, voxel_ID, true);
+    }
+
+    /**
+     * @brief Fills a box of the chunk with a single tile through Octree::fill and keeps the
+     *        occupancies, the cached faces and the visible faces in sync with the trees.
+     *        The faces of the whole chunk are resolved again, seams touched by the box are
+     *        left to the jobs of the neighbors.
+     * @param aabb     Box in chunk coordinates, min inclusive and max exclusive.
+     *                 Anything outside of the chunk is ignored.
+     * @param voxel_ID The tile of the filled volume.
+     * @param water    Selects the water trees.
+     */
+    auto Chunk::fill_box(const util::aabb::AABB<i32> &aabb, u16 voxel_ID, bool water) -> void {
+        const auto min = glm::max(aabb.min, glm::ivec3 { 0, MIN_HEIGHT, 0 });
+        const auto max = glm::min(aabb.max, glm::ivec3 { CHUNK_SIZE, CHUNK_SEGMENT_YOFFS(CHUNK_SEGMENTS), CHUNK_SIZE });
+
+        if (min.x >= max.x || min.y >= max.y || min.z >= max.z)
+            return;
+
+        const bool hidden = translucent(voxel_ID, water);
+
+        bool changed = false;
+        for (i32 i = (min.y - MIN_HEIGHT) / CHUNK_SIZE; i <= (max.y - 1 - MIN_HEIGHT) / CHUNK_SIZE; ++i) {
+            auto &segment = this->chunk_segments[i];
+            const i32 base = CHUNK_SEGMENT_YOFFS(i);
+
+            auto local = aabb;
+            local.min = min - glm::ivec3 { 0, base, 0 };
+            local.max = max - glm::ivec3 { 0, base, 0 };
+
+            if (!segment.tree(water).fill(local, voxel_ID))
+                continue;
+
+            segment.occupy(
+                    water,
+                    glm::max(local.min, glm::ivec3 { 0 }),
+                    glm::min(local.max, glm::ivec3 { CHUNK_SIZE }),
+                    hidden);
+
+            segment.stream_dirty = true;
+            segment.chunk_modified = true;
+            changed = true;
+        }
+
+        if (!changed)
+            return;
+
+        if (min.x == 0)
+            outdate(Position::BACK);
+        if (max.x == CHUNK_SIZE)
+            outdate(Position::FRONT);
+        if (min.z == 0)
+            outdate(Position::LEFT);
+        if (max.z == CHUNK_SIZE)
+            outdate(Position::RIGHT);
+
+        // the filled cubes start with every face visible, like inserted voxels
+        finalize_faces();
+
+        u32 visible = 0;
+        for (const auto &segment : this->chunk_segments)
+            visible += segment.tree(water).histogram().visible;
+
+        (water ? this->water_size : this->voxel_size).store(visible, std::memory_order_relaxed);
+    }
+
+    template <>
+    auto Chunk::stage<RenderType::CHUNK_RENDERER>(
+            const glm::ivec3 position,
+            u16 voxel_ID) -> void {
+        this->staging->voxels[CHUNK_SEGMENT_Y_DIFF(position)].push_back(pack(position, voxel_ID));
+    }
+
+    template <>
+    auto Chunk::stage<RenderType::WATER_RENDERER>(
+            const glm::ivec3 position,
+            u16 voxel_ID) -> void {
+        this->staging->water[CHUNK_SEGMENT_Y_DIFF(position)].push_back(pack(position, voxel_ID));
+    }
+
+    /**
+     * @brief  Packs a voxel like insert does, with every face visible.
+     * @param  position The position of the voxel inside the chunk.
+     * @param  voxel_ID The tile of the voxel.
+     * @return The packed voxel.
+     */
+    auto Chunk::pack(glm::ivec3 position, u16 voxel_ID) const -> u64 {
+        auto normalized_vec = CHUNK_SEGMENT_Y_NORMALIZE(position);
+
+        u64 x = static_cast<u8>(normalized_vec.x) & MASK_5;
+        u64 y = static_cast<u8>(normalized_vec.y) & MASK_5;
+        u64 z = static_cast<u8>(normalized_vec.z) & MASK_5;
+
+        u32 packed_data_highp = (x << 13) | (y <<  8) | (z <<  3) | MASK_3;
+        u32 packed_data_lowp = voxel_ID & 0x1FF;
+
+        return SET_FACES | (static_cast<u64>(packed_data_highp) << SHIFT_HIGH) | packed_data_lowp;
+    }
+
+    /**
+     * @brief Builds one tree in bulk from its staged voxels and fills its occupancy.
+     *        All faces stay visible until finalize_faces resolves them.
+     * @param tree Segment index times 2, the lowest bit selects the water tree.
+     */
+    auto Chunk::build_staged(u8 tree) -> void {
+
+        // one slot per morton code of a segment, scattering sorts in linear time
+        thread_local std::vector<u64> slots(1 << 15, 0);
+
+        const u8 i = tree >> 1;
+        const bool water = tree & 0x1;
+
+        auto &segment = this->chunk_segments[i];
+        auto &voxels = water ? this->staging->water[i] : this->staging->voxels[i];
+        auto &occupancy = water ? segment.water_occupancy : segment.voxel_occupancy;
+        auto &translucency = water ? segment.water_translucent : segment.voxel_translucent;
+        auto &root = segment.tree(water);
+
+        // a restored tree stays edited, a rejected one is generated again
+        const auto edits = this->staging->edits[tree];
+        if (!edits.empty() && root.deserialize(edits).isOk()) {
+            root.for_each_in_box(util::aabb::AABB<i32> { CHUNK_SIZE }, [&](u64 packed_data) -> void {
+                const u32 high = packed_data >> SHIFT_HIGH;
+                const i32 exponent = high & MASK_3;
+                const i32 half = exponent ? (1 << (exponent - 1)) : 0;
+
+                const auto min = glm::ivec3 {
+                        static_cast<i32>((high >> 0xD) & MASK_5) - half,
+                        static_cast<i32>((high >> 0x8) & MASK_5) - half,
+                        static_cast<i32>((high >> 0x3) & MASK_5) - half
+                };
+
+                segment.occupy(water, min, min + (1 << exponent), translucent(packed_data & MASK_VOXEL_ID, water));
+            });
+
+            segment.chunk_modified = true;
+            return;
+        }
+
+        // staged voxels always carry an exponent, thus no slot holding one is 0
+        for (const u64 voxel : voxels) {
+            const u8 x = (voxel >> 0x2D) & MASK_5;
+            const u8 y = (voxel >> 0x28) & MASK_5;
+            const u8 z = (voxel >> 0x23) & MASK_5;
+
+            slots[node_inline::morton(voxel >> SHIFT_HIGH)] = voxel;
+            occupancy.set(x, y, z);
+
+            if (translucent(voxel & MASK_VOXEL_ID, water))
+                translucency.set(x, y, z);
+        }
+
+        size_t count = 0;
+        if (!voxels.empty()) {
+            for (u64 &slot : slots) {
+                if (slot) {
+                    voxels[count++] = slot;
+                    slot = 0;
+                }
+            }
+        }
+
+        voxels.resize(count);
+
+        root.build_from_sorted(voxels);
+        root.updateFaceMask();
+    }
+
+    /**
+     * @brief Resolves the faces of both trees of every segment in one sweep over the occupancy.
+     *
+     * Which voxels hide a face follows the culling flags of their tiles, see translucent,
+     * leaves of tiles that can not be culled by others keep their faces. Seams are resolved
+     * against the neighbors that finished generating, the other sides stay visible until
+     * the pass runs again. Only the trees of this chunk are written.
+     */
+    auto Chunk::finalize_faces() -> void {
+        thread_local Occupancy::Padded cullers;
+        thread_local Occupancy::Rows x_neg;
+        thread_local Occupancy::Rows x_pos;
+        thread_local std::array<Occupancy::Rows, 6> exposed;
+
+        constexpr const i32 pitch = CHUNK_SIZE + 2;
+
+        // edits of neighbors made from now on need another pass
+        this->outdated.store(0, std::memory_order_release);
+
+        // neighbors whose occupancy is complete, indexed by Position
+        std::array<const Chunk *, 4> ready {};
+        for (u8 p = 0; p < this->neighbors.size(); ++p) {
+            const auto *ptr = this->neighbors[p];
+            if (ptr && ptr->generated.load(std::memory_order_acquire))
+                ready[p] = ptr;
+        }
+
+        auto culler_row = [](const Chunk *chunk, i32 segment_idx, bool water, i32 y, i32 z) -> u32 {
+            if (!chunk || segment_idx < 0 || segment_idx >= CHUNK_SEGMENTS)
+                return 0;
+
+            const auto &segment = chunk->chunk_segments[segment_idx];
+            const u32 opaque = segment.voxel_occupancy.row(y, z) & ~segment.voxel_translucent.row(y, z);
+
+            return water ? opaque | (segment.water_occupancy.row(y, z) & ~segment.water_translucent.row(y, z)) : opaque;
+        };
+
+        u16 faces = 0;
+        for (i32 i = 0; i < CHUNK_SEGMENTS; ++i) {
+            auto &segment = this->chunk_segments[i];
+
+            for (const bool water : { false, true }) {
+                const auto *rows = water ? segment.water_occupancy.data() : segment.voxel_occupancy.data();
+                if (!rows)
+                    continue;
+
+                for (i32 y = -1; y <= CHUNK_SIZE; ++y) {
+                    for (i32 z = -1; z <= CHUNK_SIZE; ++z) {
+                        u32 row = 0;
+
+                        if (y == -1 && z >= 0 && z < CHUNK_SIZE)
+                            row = culler_row(this, i - 1, water, CHUNK_SIZE - 1, z);
+                        else if (y == CHUNK_SIZE && z >= 0 && z < CHUNK_SIZE)
+                            row = culler_row(this, i + 1, water, 0, z);
+                        else if (y >= 0 && y < CHUNK_SIZE && z == -1)
+                            row = culler_row(ready[Position::LEFT], i, water, y, CHUNK_SIZE - 1);
+                        else if (y >= 0 && y < CHUNK_SIZE && z == CHUNK_SIZE)
+                            row = culler_row(ready[Position::RIGHT], i, water, y, 0);
+                        else if (y >= 0 && y < CHUNK_SIZE)
+                            row = culler_row(this, i, water, y, z);
+
+                        cullers[(y + 1) * pitch + z + 1] = row;
+                    }
+                }
+
+                for (i32 y = 0; y < CHUNK_SIZE; ++y) {
+                    for (i32 z = 0; z < CHUNK_SIZE; ++z) {
+                        x_neg[y * CHUNK_SIZE + z] = culler_row(ready[Position::BACK], i, water, y, z);
+                        x_pos[y * CHUNK_SIZE + z] = culler_row(ready[Position::FRONT], i, water, y, z);
+                    }
+                }
+
+                Occupancy::expose(*rows, cullers, x_neg, x_pos, exposed);
+
+                // a face of a leaf is visible if any voxel on that side of its volume exposes it
+                auto resolve = [&](u64 packed_data) -> u64 {
+                    const auto &tile = tiles::tile_manager::tile_manager[packed_data & MASK_VOXEL_ID];
+                    if (!(tile.flags & tiles::tile::can_be_culled_by_other))
+                        return SET_FACES;
+
+                    const u32 high = packed_data >> SHIFT_HIGH;
+                    const u32 exponent = high & MASK_3;
+                    const u32 side = 1 << exponent;
+                    const u32 half = side >> 1;
+
+                    const u32 x = ((high >> 0xD) & MASK_5) - half;
+                    const u32 y = ((high >> 0x8) & MASK_5) - half;
+                    const u32 z = ((high >> 0x3) & MASK_5) - half;
+
+                    const u32 span = side == CHUNK_SIZE ? UINT32_MAX : ((1u << side) - 1) << x;
+
+                    u32 left = 0, right = 0, top = 0, bottom = 0, front = 0, back = 0;
+                    for (u32 a = 0; a < side; ++a) {
+                        for (u32 b = 0; b < side; ++b) {
+                            left  |= exposed[0][(y + a) * CHUNK_SIZE + z + b];
+                            right |= exposed[1][(y + a) * CHUNK_SIZE + z + b];
+                        }
+
+                        top    |= exposed[2][(y + side - 1) * CHUNK_SIZE + z + a];
+                        bottom |= exposed[3][y * CHUNK_SIZE + z + a];
+                        front  |= exposed[4][(y + a) * CHUNK_SIZE + z + side - 1];
+                        back   |= exposed[5][(y + a) * CHUNK_SIZE + z];
+                    }
+
+                    return (((left >> x) & 0x1) ? LEFT_BIT : 0) |
+                           (((right >> (x + side - 1)) & 0x1) ? RIGHT_BIT : 0) |
+                           ((top & span) ? TOP_BIT : 0) |
+                           ((bottom & span) ? BOTTOM_BIT : 0) |
+                           ((front & span) ? FRONT_BIT : 0) |
+                           ((back & span) ? BACK_BIT : 0);
+                };
+
+                faces |= segment.tree(water).resolve_faces(resolve);
+                segment.stream_dirty = true;
+            }
+        }
+
+        u8 seams = 0;
+        for (u8 p = 0; p < ready.size(); ++p)
+            if (ready[p])
+                seams |= 1 << p;
+
+        this->faces = faces;
+        this->seams = seams;
+    }
+
+    /**
+     * @brief  Checks for neighbors that finished generating after the last finalize_faces
+     *         and for seams outdated by edits of a neighbor.
+     * @return Boolean indicating if a seam can be resolved.
+     */
+    auto Chunk::unresolved_seams() const -> bool {
+        if (this->outdated.load(std::memory_order_acquire))
+            return true;
+
+        for (u8 p = 0; p < this->neighbors.size(); ++p) {
+            if (this->seams & (1 << p))
+                continue;
+
+            const auto *ptr = this->neighbors[p];
+            if (ptr && ptr->generated.load(std::memory_order_acquire))
+                return true;
+        }
+
+        return false;
+    }
+
     inline
     auto Chunk::update_occlusion(
             node::Node *current,
-            node::Node *neighbor,
+            glm::ivec3 position,
             u64 current_mask,
             u64 neighbor_mask) -> void {
-        if (!neighbor)
+        // the tree of the neighbor is only copied once a face of it gets hidden
+        const u64 neighbor_data = lookup(position);
+        if (!neighbor_data)
             return;
 
         const auto current_id = current->packed_data & 0x1FF;
-        const auto neighbor_id = neighbor->packed_data & 0x1FF;
+        const auto neighbor_id = neighbor_data & 0x1FF;
         const auto &current_voxel_config = tiles::tile_manager::tile_manager[current_id];
         const auto &neighbor_voxel_config = tiles::tile_manager::tile_manager[neighbor_id];
 
@@ -230,88 +857,330 @@ namespace core::level::chunk {
         if (!current_voxel_config.can_cull(neighbor_voxel_config))
             return;
 
+        // faces of a neighbor chunk are left to its own job, see Chunk::invalidate
+        if (position.x < 0 || position.x >= CHUNK_SIZE || position.z < 0 || position.z >= CHUNK_SIZE)
+            return;
+
         // the neighbor is a simple BASE_SIZE voxel
-        auto neighbor_cube_side = 1 << ((neighbor->packed_data >> SHIFT_HIGH) & MASK_3);
+        auto neighbor_cube_side = 1 << ((neighbor_data >> SHIFT_HIGH) & MASK_3);
         if (neighbor_cube_side == BASE_SIZE) {
-            neighbor->packed_data &= ~neighbor_mask;
+            find(position)->packed_data &= ~neighbor_mask;
             return;
         }
 
         // the neighbor is bigger than BASE_SIZE
         // we need to check for all other voxels of this quad if it is occluded
-        auto &map = this->occlusion_map[neighbor_mask];
-        if (map.contains(neighbor)) {
-            ++map[neighbor];
-
-            if (map[neighbor] == neighbor_cube_side * neighbor_cube_side)
-                neighbor->packed_data &= ~neighbor_mask;
-        }
-        else {
-            map[neighbor] = 1;
-        }
-    }
-
+        if (!this->occlusion)
+            this->occlusion = std::make_unique<OcclusionCounters>();
 
-    auto Chunk::find(std::function<f32(const glm::vec3 &,const u32)> &fun) -> f32 {
-        auto ray_scale = std::numeric_limits<f32>::max();
+        const auto key = OcclusionCounters::key(
+                neighbor_mask, neighbor_data, OcclusionCounters::placement(position));
 
-        for (auto i = 0; i < this->chunk_segments.size(); ++i) {
-            const auto offset = glm::ivec3(0, (i - 4) * CHUNK_SIZE, 0);
-            const auto position = this->chunk_pos + offset;
-            const auto ret = this->chunk_segments[i].voxel_root->find(position, fun);
+        auto &count = (*this->occlusion)[key];
+        if (++count == static_cast<u32>(neighbor_cube_side * neighbor_cube_side))
+            find(position)->packed_data &= ~neighbor_mask;
+    }
 
-            ray_scale = ret < ray_scale ? ret : ray_scale;
-        }
 
-        return ray_scale;
-    }
-    
     template<> 
     auto Chunk::remove<RenderType::CHUNK_RENDERER>(
             glm::ivec3 position) -> void {
         auto normalized_vec = CHUNK_SEGMENT_Y_NORMALIZE(position);
+        auto &segment = this->chunk_segments[CHUNK_SEGMENT_Y_DIFF(position)];
 
         u16 x = static_cast<u8>(normalized_vec.x) & MASK_5;
         u16 y = static_cast<u8>(normalized_vec.y) & MASK_5;
         u16 z = static_cast<u8>(normalized_vec.z) & MASK_5;
 
         const u16 compressed_pos = (x << 10) | (y << 5) | z;
-        this->chunk_segments[CHUNK_SEGMENT_Y_DIFF(position)].voxel_root->removePoint(compressed_pos);
+
+        i32 faces = 0;
+        if (!segment.tree(false).removePoint(compressed_pos, faces))
+            return;
+
+        segment.voxel_occupancy.reset(x, y, z);
+        segment.voxel_translucent.reset(x, y, z);
+
+        this->voxel_size = static_cast<u32>(static_cast<i64>(this->voxel_size) + faces);
+
+        // occlusion culling
+        restore_occlusion(position);
+        segment.chunk_modified = true;
+        segment.stream_dirty = true;
     }
 
     template<>
     auto Chunk::remove<RenderType::WATER_RENDERER>(
             glm::ivec3 position) -> void {
         auto normalized_vec = CHUNK_SEGMENT_Y_NORMALIZE(position);
+        auto &segment = this->chunk_segments[CHUNK_SEGMENT_Y_DIFF(position)];
 
         u16 x = static_cast<u8>(normalized_vec.x) & MASK_5;
         u16 y = static_cast<u8>(normalized_vec.y) & MASK_5;
         u16 z = static_cast<u8>(normalized_vec.z) & MASK_5;
 
         const u16 compressed_pos = (x << 10) | (y << 5) | z;
-        this->chunk_segments[CHUNK_SEGMENT_Y_DIFF(position)].water_root->removePoint(compressed_pos);
+
+        i32 faces = 0;
+        if (!segment.tree(true).removePoint(compressed_pos, faces))
+            return;
+
+        segment.water_occupancy.reset(x, y, z);
+        segment.water_translucent.reset(x, y, z);
+
+        this->water_size = static_cast<u32>(static_cast<i64>(this->water_size) + faces);
+
+        // occlusion culling
+        restore_occlusion(position);
+        segment.chunk_modified = true;
+        segment.stream_dirty = true;
+    }
+
+    /**
+     * @brief Inverse of update_occlusion. Every face of the neighbors facing the now empty
+     *        position becomes visible.
+     * @param position The position of the removed voxel.
+     */
+    auto Chunk::restore_occlusion(glm::ivec3 position) -> void {
+        reveal(position - glm::ivec3 {1, 0, 0}, RIGHT_BIT);
+        reveal(position + glm::ivec3 {1, 0, 0}, LEFT_BIT);
+        reveal(position - glm::ivec3 {0, 1, 0}, TOP_BIT);
+        reveal(position + glm::ivec3 {0, 1, 0}, BOTTOM_BIT);
+        reveal(position - glm::ivec3 {0, 0, 1}, FRONT_BIT);
+        reveal(position + glm::ivec3 {0, 0, 1}, BACK_BIT);
+    }
+
+    /**
+     * @brief Sets a face of the voxel at a position to visible.
+     *        Positions outside of the chunk mark the seam of the respective neighbor as outdated.
+     * @param position The position of the voxel.
+     * @param mask     The face to reveal.
+     */
+    auto Chunk::reveal(glm::ivec3 position, u64 mask) -> void {
+
+        // inter-chunk-revealing, the neighbor resolves its seam again within its own job
+        if (position.x >= CHUNK_SIZE)
+            outdate(Position::FRONT);
+        else if (position.x < 0)
+            outdate(Position::BACK);
+        else if (position.z >= CHUNK_SIZE)
+            outdate(Position::RIGHT);
+        else if (position.z < 0)
+            outdate(Position::LEFT);
+
+        // intra-chunk-revealing
+        else {
+            const auto segment_idx = CHUNK_SEGMENT_Y_DIFF(position);
+            if (segment_idx < 0 || segment_idx >= CHUNK_SEGMENTS)
+                return;
+
+            auto normalized_vec = CHUNK_SEGMENT_Y_NORMALIZE(position);
+            auto &segment = this->chunk_segments[segment_idx];
+
+            u64 x = static_cast<u8>(normalized_vec.x) & MASK_5;
+            u64 y = static_cast<u8>(normalized_vec.y) & MASK_5;
+            u64 z = static_cast<u8>(normalized_vec.z) & MASK_5;
+
+            u32 packed_data_highp = (x << 13) | (y << 8) | (z << 3) | MASK_3;
+
+            auto [node, hidden] = segment.tree(false).reveal(packed_data_highp, mask);
+            auto *size = &this->voxel_size;
+
+            if (!node) {
+                std::tie(node, hidden) = segment.tree(true).reveal(packed_data_highp, mask);
+                size = &this->water_size;
+            }
+
+            if (!node)
+                return;
+
+            segment.stream_dirty = true;
+            this->faces |= static_cast<u16>(mask >> 50);
+            if (hidden)
+                ++(*size);
+
+            // the neighbor is bigger than BASE_SIZE
+            // one of its occluded sub faces is exposed again
+            if (((node->packed_data >> SHIFT_HIGH) & MASK_3) && this->occlusion) {
+                auto *count = this->occlusion->find(
+                        OcclusionCounters::key(mask, node->packed_data, OcclusionCounters::placement(position)));
+                if (count && *count)
+                    --(*count);
+            }
+        }
+    }
+
+    /**
+     * @brief Rebuilds the cached face streams of both trees of a segment.
+     * @param segment The segment whose trees changed.
+     */
+    auto Chunk::rebuild_streams(ChunkSegment &segment) -> void {
+        thread_local std::array<std::vector<u64>, 6> faces;
+
+        for (auto [water, stream] : {
+                std::pair { false, &segment.voxel_stream },
+                std::pair { true, &segment.water_stream } }) {
+            for (auto &vec : faces)
+                vec.clear();
+
+            // the snapshot stays valid even if the working tree is edited meanwhile
+            if (const auto tree = segment.snapshot(water))
+                tree->stream(faces, segment.stream_level);
+
+#if CHUNK_GREEDY_FACES
+            greedy::merge(faces);
+#endif
+
+            stream->faces.clear();
+            for (u8 i = 0; i < faces.size(); ++i) {
+                stream->offsets[i] = static_cast<u32>(stream->faces.size());
+                stream->faces.insert(stream->faces.end(), faces[i].begin(), faces[i].end());
+            }
+
+            stream->offsets[faces.size()] = static_cast<u32>(stream->faces.size());
+        }
     }
 
-    auto Chunk::cull(state::State &state) const -> void {
-        auto global_root = state.platform.get_world_root();
-        auto pos = glm::ivec3(global_root.x, 0, global_root.y) + this->chunk_pos;
+    /**
+     * @brief Marks the cached faces of the segment at a position as outdated.
+     *        Positions outside of the chunk mark the seam of the respective neighbor as outdated.
+     * @param position The position inside the segment.
+     */
+    auto Chunk::invalidate(glm::ivec3 position) -> void {
+
+        // inter-chunk-invalidation, the neighbor resolves its seam again within its own job
+        if (position.x >= CHUNK_SIZE)
+            outdate(Position::FRONT);
+        else if (position.x < 0)
+            outdate(Position::BACK);
+        else if (position.z >= CHUNK_SIZE)
+            outdate(Position::RIGHT);
+        else if (position.z < 0)
+            outdate(Position::LEFT);
+
+        // intra-chunk-invalidation
+        else {
+            const auto segment_idx = CHUNK_SEGMENT_Y_DIFF(position);
+            if (segment_idx >= 0 && segment_idx < CHUNK_SEGMENTS)
+                this->chunk_segments[segment_idx].stream_dirty = true;
+        }
+    }
+
+    /**
+     * @brief Writes the faces visible to the camera into the renderers.
+     *        Trees are only traversed if their segment changed, otherwise the cached
+     *        faces of every segment inside the frustum are copied. The segments are tested
+     *        against the frustum 8 at a time.
+     *        Distant segments are streamed at a coarser level, volumes whose projected
+     *        edge length falls below LOD_PROJECTED_SIZE are drawn as a single cube.
+     * @param state The global state.
+     */
+    auto Chunk::cull(state::State &state) -> void {
+        auto pos = this->chunk_pos;
+
+        const auto &camera = state.player.get_camera();
+        const u8 mask = camera.get_mask();
+
+        static_assert(!(CHUNK_SEGMENTS & 0x7), "segments are classified 8 at a time");
+
+        // bounding spheres of the segments, every group of 8 is tested in a single pass
+        util::culling::Spheres spheres;
+        spheres.radius.fill(static_cast<f32>(CHUNK_SIZE) * SQRT_2);
+
+        u16 initialized = 0;
+        u16 visible = 0;
+        for (u8 i = 0; i < this->chunk_segments.size(); ++i) {
+            pos.y = (i - 4) * CHUNK_SIZE;
+            const auto center = glm::vec3(pos) + glm::vec3(CHUNK_SIZE / 2);
+
+            spheres.x[i & 0x7] = center.x;
+            spheres.y[i & 0x7] = center.y;
+            spheres.z[i & 0x7] = center.z;
+
+            if ((i & 0x7) == 0x7) {
+                const u8 outside = camera.frustum_collision(spheres).outside;
+                visible |= static_cast<u16>(static_cast<u8>(~outside)) << (i & ~0x7);
+            }
+
+            auto &segment = this->chunk_segments[i];
+            if (!segment.initialized)
+                continue;
+
+            initialized |= 1 << i;
+
+            // largest exponent 2^e with 2^e / distance below the projected size
+            const f32 distance = glm::distance(center, camera.get_position());
+            const u8 level = static_cast<u8>(std::clamp(
+                    static_cast<i32>(std::floor(std::log2(std::max(distance * LOD_PROJECTED_SIZE, 1.0F)))),
+                    0, LOD_MAX_LEVEL));
+
+            const bool dirty = segment.stream_dirty.exchange(false);
+            if (dirty || segment.stream_level != level) {
+                segment.stream_level = level;
+                rebuild_streams(segment);
+            }
+        }
+
+        visible &= initialized;
+
+        // number of faces of the segments inside the frustum seen by the camera
+        auto count = [&](FaceStream ChunkSegment::*stream) -> u64 {
+            u64 size = 0;
+            for (u8 i = 0; i < this->chunk_segments.size(); ++i) {
+                if (!(visible & (1 << i)))
+                    continue;
+
+                const auto &offsets = (this->chunk_segments[i].*stream).offsets;
+                for (u8 j = 0; j < 6; ++j)
+                    if (mask & (1 << j))
+                        size += offsets[j + 1] - offsets[j];
+            }
+
+            return size;
+        };
+
+        auto emit = [&](FaceStream ChunkSegment::*stream, const VERTEX *buffer, u64 &actual_size) -> void {
+            const auto &mesh = model::voxel::cube_structure.mesh();
+            const auto emit_faces = node_kernels::kernels.emit_faces;
+
+            for (u8 i = 0; i < this->chunk_segments.size(); ++i) {
+                if (!(visible & (1 << i)))
+                    continue;
+
+                const auto &ref = this->chunk_segments[i].*stream;
+
+                // the nodes are position independent, the placement is the same for every face
+                const u64 placement = (static_cast<u64>(this->chunk_idx) << 20) | (static_cast<u64>(i) << 16);
+
+                for (u8 j = 0; j < 6; ++j) {
+                    if (!(mask & (1 << j)))
+                        continue;
+
+                    const u32 count = ref.offsets[j + 1] - ref.offsets[j];
+                    emit_faces(
+                            mesh[j],
+                            placement,
+                            ref.faces.data() + ref.offsets[j],
+                            count,
+                            const_cast<VERTEX *>(buffer) + actual_size);
+
+                    actual_size += count;
+                }
+            }
+        };
 
         if (this->voxel_size) {
+            const u64 size = count(&ChunkSegment::voxel_stream);
+
             u64 actual_size = 0;
             auto *buffer = reinterpret_cast<chunk::chunk_renderer::ChunkRenderer &>(
                     state.renderer
                         .get_sub_renderer(rendering::renderer::CHUNK_RENDERER))
-                        .request_writeable_area(this->voxel_size, threading::thread_pool::worker_id);
+                        .request_writeable_area(size, threading::thread_pool::worker_id);
 
-            for (u8 i = 0; i < this->chunk_segments.size(); ++i) {
-                if (this->chunk_segments[i].initialized) {
-                    pos.y = (i - 4) * CHUNK_SIZE;
-                    this->chunk_segments[i].voxel_root->cull(
-                            pos, state.player.get_camera(), buffer, actual_size);
-                }
-            }
+            emit(&ChunkSegment::voxel_stream, buffer, actual_size);
 
-            ASSERT_EQ(actual_size <= this->water_size);
+            ASSERT_EQ(actual_size <= size);
             reinterpret_cast<chunk::chunk_renderer::ChunkRenderer &>(
                     state.renderer
                         .get_sub_renderer(rendering::renderer::CHUNK_RENDERER))
@@ -319,21 +1188,17 @@ namespace core::level::chunk {
         }
 
         if (this->water_size) {
+            const u64 size = count(&ChunkSegment::water_stream);
+
             u64 actual_size = 0;
             auto  *buffer = reinterpret_cast<chunk::chunk_renderer::ChunkRenderer &>(
                     state.renderer
                         .get_sub_renderer(rendering::renderer::WATER_RENDERER))
-                        .request_writeable_area(this->water_size, threading::thread_pool::worker_id);
+                        .request_writeable_area(size, threading::thread_pool::worker_id);
 
-            for (u8 i = 0; i < this->chunk_segments.size(); ++i) {
-                if (this->chunk_segments[i].initialized) {
-                    pos.y = static_cast<f32>((i - 4) * CHUNK_SIZE);
-                    this->chunk_segments[i].water_root->cull(
-                            pos, state.player.get_camera(), buffer, actual_size);
-                }
-            }
+            emit(&ChunkSegment::water_stream, buffer, actual_size);
 
-            ASSERT_EQ(actual_size <= this->water_size);
+            ASSERT_EQ(actual_size <= size);
             reinterpret_cast<chunk::chunk_renderer::ChunkRenderer &>(
                     state.renderer
                         .get_sub_renderer(rendering::renderer::WATER_RENDERER))
@@ -341,71 +1206,208 @@ namespace core::level::chunk {
         }
     }
 
-    auto Chunk::recombine() -> void {
+    /**
+     * @brief Recombines the trees of all segments that are not ready yet, one sub-task per tree.
+     *        The last sub-task to finish marks the segments as ready.
+     * @param pool Pool running the sub-tasks.
+     */
+    auto Chunk::recombine(threading::thread_pool::Tasksystem<> &pool) -> void {
+        this->pending_trees.store(CHUNK_TREES, std::memory_order_relaxed);
+
+        for (u8 tree = 0; tree < CHUNK_TREES; ++tree) {
+            pool.enqueue_detach([this, tree]() -> void {
+                auto &ref = this->chunk_segments[tree >> 1];
+
+                if (!ref.initialized) {
+                    auto &root = ref.tree(tree & 0x1);
+                    auto &size = (tree & 0x1) ? this->water_size : this->voxel_size;
+
+                    // compress SVO, the visible faces are counted on the way
+                    size.fetch_add(root.recombine().visible, std::memory_order_relaxed);
+#if OCTREE_DAG
+                    root.deduplicate();
+#else
+                    // the tree is complete, the survivors are relayouted once
+                    root.compact();
+#endif
+                }
+
+                // indicate readiness once the render traversal can read the trees
+                if (this->pending_trees.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    for (auto &segment : this->chunk_segments) {
+                        segment.publish();
+                        segment.initialized = true;
+                    }
+                }
+            });
+        }
+    }
+
+    /**
+     * @brief Moves the trees of every segment into the shared dag if OCTREE_DAG is set.
+     *        Identical subtrees of all chunks are stored once, modifications copy a tree back.
+     */
+    auto Chunk::deduplicate() -> void {
+#if OCTREE_DAG
         for (auto &ref : this->chunk_segments) {
-            if (!ref.initialized) {
-
-                // compress SVO
-                ref.voxel_root->recombine();
-                this->voxel_size +=
-                        ref.voxel_root->count_mask(TOP_BIT) +
-                        ref.voxel_root->count_mask(BOTTOM_BIT) +
-                        ref.voxel_root->count_mask(FRONT_BIT) +
-                        ref.voxel_root->count_mask(BACK_BIT) +
-                        ref.voxel_root->count_mask(LEFT_BIT) +
-                        ref.voxel_root->count_mask(RIGHT_BIT);
-
-                // compress SVO
-                ref.water_root->recombine();
-                this->water_size += ref.water_root->count_mask(TOP_BIT);
-
-                // indicate readiness
-                ref.initialized = true;
-            }
+            ref.tree(false).deduplicate();
+            ref.tree(true).deduplicate();
         }
+#endif
     }
 
-    auto Chunk::update_and_render(u16 nchunk_idx, state::State &state) -> void {
-        this->chunk_idx = nchunk_idx & 0xFFF;
-        this->chunk_pos = glm::ivec3 {
-                (this->chunk_idx % (RENDER_RADIUS * 2)) - RENDER_RADIUS,
-                0,
-                (this->chunk_idx / (RENDER_RADIUS * 2)) - RENDER_RADIUS
-        };
-        this->chunk_pos *= static_cast<f32>(CHUNK_SIZE);
+    /**
+     * @brief Makes the edits of every segment visible to the render traversal.
+     *        Must be called by the thread editing the chunk once a batch of edits is complete.
+     */
+    auto Chunk::publish() -> void {
+        for (auto &segment : this->chunk_segments)
+            segment.publish();
+
+        // the batch of edits is complete, the counters are not needed anymore
+        this->occlusion.reset();
+    }
+
+    auto Chunk::index() const -> u16 {
+        return this->chunk_idx;
+    }
+
+    /** @brief Indicates the generating job finished including the faces, set by the last tree of generate */
+    auto Chunk::is_generated() const -> bool {
+        return this->resolved.load(std::memory_order_acquire);
+    }
 
-        for (u8 i = 0; i < CHUNK_SEGMENTS; ++i) {
-            if (this->chunk_segments[i].initialized) {
-                this->chunk_segments[i].voxel_root->update_chunk_mask((this->chunk_idx << 4) | i);
-                this->chunk_segments[i].water_root->update_chunk_mask((this->chunk_idx << 4) | i);
+    /** @brief Indicates every segment is recombined and drawn, set by the last tree of recombine */
+    auto Chunk::is_initialized() const -> bool {
+        return this->chunk_segments.back().initialized.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief  Approximates the heap memory held by the chunk, published snapshots are only
+     *         counted if they are no longer shared with the working trees.
+     * @return Bytes of the trees, occupancies and cached faces of every segment.
+     */
+    auto Chunk::memory() const -> size_t {
+        size_t bytes = sizeof(Chunk);
+
+        for (const auto &segment : this->chunk_segments) {
+            bytes += sizeof(ChunkSegment);
+
+            for (const bool water : { false, true }) {
+                const auto &root = water ? segment.water_root : segment.voxel_root;
+                const auto &snapshot = water ? segment.water_snapshot : segment.voxel_snapshot;
+                const auto &occupancy = water ? segment.water_occupancy : segment.voxel_occupancy;
+                const auto &translucency = water ? segment.water_translucent : segment.voxel_translucent;
+                const auto &stream = water ? segment.water_stream : segment.voxel_stream;
+
+                if (root)
+                    bytes += sizeof(octree::Octree) + root->memory();
+
+                if (snapshot && snapshot != root)
+                    bytes += sizeof(octree::Octree) + snapshot->memory();
+
+                if (occupancy.data())
+                    bytes += sizeof(Occupancy::Rows);
+
+                if (translucency.data())
+                    bytes += sizeof(Occupancy::Rows);
+
+                bytes += stream.faces.capacity() * sizeof(u64);
             }
         }
 
-        cull(state);
+        return bytes;
     }
 
-    auto Chunk::index() const -> u16 {
-        return this->chunk_idx;
+    /** @brief World position of the chunk in units of chunks */
+    auto Chunk::coordinates() const -> glm::ivec2 {
+        return glm::ivec2 { this->chunk_pos.x, this->chunk_pos.z } / CHUNK_SIZE;
     }
 
-    auto Chunk::visible(
-            const util::camera::Camera &camera, const glm::ivec2 &world_offset) const -> bool {
+    auto Chunk::visible(const util::camera::Camera &camera) const -> bool {
         const u64 face_mask = this->faces & static_cast<u64>(camera.get_mask());
         if (!face_mask || !(this->voxel_size + this->water_size))
             return false;
 
-        auto offset = glm::ivec2(this->chunk_pos.x, this->chunk_pos.z);
-        return camera.check_in_frustum(world_offset + offset, CHUNK_SIZE);
+        return camera.check_in_frustum(glm::vec2(this->chunk_pos.x, this->chunk_pos.z), CHUNK_SIZE);
     }
 
-    auto Chunk::add_neigbor(Position position, std::shared_ptr<Chunk> neighbor) -> void {
-        for (auto &[p, w] : this->neighbors) {
-            if (p == position && w.expired()) {
-                w = std::move(neighbor);
-                return;
+    auto Chunk::add_neigbor(Position position, Chunk *neighbor) -> void {
+
+        // the seam has to be resolved again against a new neighbor
+        if (this->neighbors[position] != neighbor)
+            this->seams &= ~(1 << position);
+
+        this->neighbors[position] = neighbor;
+    }
+
+    /**
+     * @brief Marks the seam of a neighbor towards this chunk as outdated after an edit next to it.
+     *        The neighbor is not written, its faces are resolved again by its own next job.
+     * @param position The neighbor by Position.
+     */
+    auto Chunk::outdate(Position position) -> void {
+        if (auto *ptr = this->neighbors[position])
+            ptr->outdated.fetch_or(1 << opposite[position], std::memory_order_acq_rel);
+    }
+
+    /**
+     * @brief  Appends the trees of every edited segment, the next generation of a chunk at the
+     *         same coordinates restores them. Every tree is preceded by its index (segment
+     *         times 2, the lowest bit selects water) and its size in bytes.
+     * @param  out Buffer the trees are appended to.
+     * @return Boolean indicating if any segment was edited.
+     */
+    auto Chunk::serialize(std::vector<u8> &out) const -> bool {
+
+        // restored trees that were not generated yet are handed on unchanged
+        if (!this->edits.empty()) {
+            out.insert(out.end(), this->edits.begin(), this->edits.end());
+            return true;
+        }
+
+        bool edited = false;
+
+        for (const auto &segment : this->chunk_segments) {
+            if (!segment.chunk_modified)
+                continue;
+
+            for (const bool water : { false, true }) {
+                const size_t at = out.size();
+                out.resize(at + 1 + sizeof(u32));
+                segment.tree(water).serialize(out);
+
+                const u32 size = static_cast<u32>(out.size() - at - 1 - sizeof(u32));
+                out[at] = static_cast<u8>((segment.segment_idx << 1) | water);
+                std::memcpy(out.data() + at + 1, &size, sizeof(u32));
             }
+
+            edited = true;
         }
 
-        this->neighbors.emplace_back(position, std::move(neighbor));
+        return edited;
+    }
+
+    /**
+     * @brief Hands trees written by Chunk::serialize to a chunk that was not generated yet,
+     *        they replace the generated trees of their segments.
+     * @param edits Trees written by Chunk::serialize.
+     */
+    auto Chunk::restore(std::vector<u8> edits) -> void {
+        this->edits = std::move(edits);
+    }
+
+    /**
+     * @brief Removes every link of the neighbors pointing to this chunk before it is destroyed.
+     *        Links of neighbors that were meanwhile replaced by another chunk are left untouched.
+     */
+    auto Chunk::detach() -> void {
+        for (u8 p = 0; p < this->neighbors.size(); ++p) {
+            auto *ptr = this->neighbors[p];
+            if (ptr && ptr->neighbors[opposite[p]] == this)
+                ptr->neighbors[opposite[p]] = nullptr;
+
+            this->neighbors[p] = nullptr;
+        }
     }
 }
\ No newline at end of file
@@ -10,9 +10,12 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <tuple>
+#include <span>
+#include <atomic>
 #include <type_traits>
 
 #include "../core/rendering/renderer.h"
+#include "../core/threading/thread_pool.h"
 #include "../core/level/chunk/chunk_segment.h"
 #include "../core/level/chunk_data_structure/octree.h"
 
@@ -32,6 +35,9 @@
 #define CHUNK_SEGMENT_Y_DIFF(_p) \
     ((static_cast<i32>((_p).y) + abs(MIN_HEIGHT)) / CHUNK_SIZE)
 
+// voxel and water tree of every segment, processed as independent sub-tasks
+#define CHUNK_TREES (CHUNK_SEGMENTS * 2)
+
 namespace core::state {
     struct State;
 }
@@ -44,55 +50,140 @@ namespace core::level::chunk {
         BACK
     };
 
-    class OcclusionMap {
+    /**
+     * @brief Covered sub faces of neighbors larger than a voxel, counted while voxels are inserted.
+     *        Open addressed with linear probing, keyed by the placement, position, scale
+     *        and face of the neighbor. Only lives until the edits are published.
+     */
+    class OcclusionCounters {
     public:
-        OcclusionMap() =default;
-        auto operator[](u64 mask) -> std::unordered_map<node::Node *, u32> &;
+        OcclusionCounters() =default;
+
+        static auto key(u64, u64, u8) -> u64;
+        static auto placement(glm::ivec3) -> u8;
+        auto operator[](u64) -> u32 &;
+        auto find(u64) -> u32 *;
 
     private:
-        std::array<std::unordered_map<node::Node *, u32>, 6> map;
+        auto grow() -> void;
+        auto slot(u64) const -> size_t;
+
+        std::vector<std::pair<u64, u32>> slots;
+        size_t used { 0 };
+    };
+
+    /** @brief Leaf volume hit by a box query, recombined volumes are reported as a whole */
+    struct Cube {
+        glm::ivec3 min;
+        i32 edge;
+        u16 voxel_ID;
+        bool water;
+    };
+
+    /** @brief Voxels collected while generating, turned into the trees in bulk afterwards */
+    struct Staging {
+        std::array<std::vector<u64>, CHUNK_SEGMENTS> voxels;
+        std::array<std::vector<u64>, CHUNK_SEGMENTS> water;
+
+        // restored trees by tree index, viewing the edits of the chunk
+        std::array<std::span<const u8>, CHUNK_TREES> edits;
     };
 
     class Chunk {
     public:
-        Chunk(u16);
+        Chunk(u16, glm::ivec2);
         ~Chunk() =default;
 
         Chunk(Chunk &&) =default;
         auto operator=(Chunk &&) -> Chunk & =default;
 
-        auto generate(glm::ivec2) -> void;
+        auto generate(threading::thread_pool::Tasksystem<> &) -> void;
 
         template <rendering::renderer::RenderType R>
         auto insert(glm::ivec3, u16, bool recombine = true) -> void;
 
+        template <rendering::renderer::RenderType R>
+        auto fill(const util::aabb::AABB<i32> &, u16) -> void;
+
+        template <rendering::renderer::RenderType R>
+        auto stage(glm::ivec3, u16) -> void;
+
         template <rendering::renderer::RenderType R>
         auto remove(glm::ivec3) -> void;
 
-        auto cull(state::State &) const -> void;
-        auto update_and_render(u16, state::State &) -> void;
+        auto cull(state::State &) -> void;
 
         auto find(glm::ivec3) -> node::Node *;
-        auto find(std::function<f32(const glm::vec3 &, const u32)> &) -> f32;
-
-        auto update_occlusion(node::Node *, node::Node *, u64, u64) -> void;
-        auto visible(const util::camera::Camera &, const glm::ivec2 &) const -> bool;
+        auto lookup(glm::ivec3, bool published = false) const -> u64;
+        auto occupied(glm::ivec3, bool water = true) -> bool;
+        auto query_box(
+                const util::aabb::AABB<i32> &,
+                const std::function<void(const Cube &)> &,
+                bool water = true) const
+                -> void;
+
+        auto update_occlusion(node::Node *, glm::ivec3, u64, u64) -> void;
+        auto restore_occlusion(glm::ivec3) -> void;
+        auto reveal(glm::ivec3, u64) -> void;
+        auto visible(const util::camera::Camera &) const -> bool;
         auto index() const -> u16;
-        auto add_neigbor(Position, std::shared_ptr<Chunk>) -> void;
-        auto recombine() -> void;
+        auto coordinates() const -> glm::ivec2;
+        auto add_neigbor(Position, Chunk *) -> void;
+        auto detach() -> void;
+        auto recombine(threading::thread_pool::Tasksystem<> &) -> void;
+        auto deduplicate() -> void;
+        auto publish() -> void;
+        auto finalize_faces() -> void;
+        auto unresolved_seams() const -> bool;
+        auto is_generated() const -> bool;
+        auto is_initialized() const -> bool;
+        auto memory() const -> size_t;
+        auto serialize(std::vector<u8> &) const -> bool;
+        auto restore(std::vector<u8>) -> void;
 
     private:
-        std::vector<std::pair<Position, std::weak_ptr<Chunk>>> neighbors;
-        OcclusionMap occlusion_map;
+        auto pack(glm::ivec3, u16) const -> u64;
+        auto fill_box(const util::aabb::AABB<i32> &, u16, bool) -> void;
+        auto build_staged(u8) -> void;
+        auto finish_generation() -> void;
+        auto rebuild_streams(ChunkSegment &) -> void;
+        auto invalidate(glm::ivec3) -> void;
+        auto outdate(Position) -> void;
+
+        // indexed by Position, only followed by tasks of the tick pool while the platform
+        // loads or compresses, links to unloaded chunks are cleared before they are destroyed
+        std::array<Chunk *, 4> neighbors {};
+        std::unique_ptr<OcclusionCounters> occlusion;
 
         std::vector<ChunkSegment> chunk_segments;
+        std::unique_ptr<Staging> staging;
 
+        // trees of edited segments restored by the next generation, see Chunk::serialize
+        std::vector<u8> edits;
+
+        // world position, the chunk index is its slot in the toroidal grid of the platform
+        // and stays the same for the whole lifetime of the chunk
         glm::ivec3 chunk_pos;
         u16 chunk_idx;
         u16 faces;
 
-        u32 voxel_size { 0 };
-        u32 water_size { 0 };
+        std::atomic<u32> voxel_size { 0 };
+        std::atomic<u32> water_size { 0 };
+
+        // trees whose sub-task did not finish yet, the last one completes the chunk
+        std::atomic<u8> pending_trees { 0 };
+
+        // set once generation finished, the occupancy can be read by neighbors afterwards
+        std::atomic_bool generated { false };
+
+        // set once the generating job resolved the faces, nothing of it runs afterwards
+        std::atomic_bool resolved { false };
+
+        // neighbors (by Position) the seams were resolved against
+        u8 seams { 0 };
+
+        // seams (by Position) whose neighbor was edited next to them since the last finalize_faces
+        std::atomic<u8> outdated { 0 };
     };
 }
 
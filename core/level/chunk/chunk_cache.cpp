@@ -0,0 +1,85 @@
+//
+// Created by Luis Ruisinger on 05.11.24.
+//
+
+#include "chunk_cache.h"
+
+namespace core::level::chunk {
+
+    ChunkCache::ChunkCache(size_t budget)
+            : budget { budget }
+    {}
+
+    /**
+     * @brief  Caches an unloaded chunk, the least recently unloaded chunks are dropped
+     *         until the budget holds again. A chunk larger than the budget is not cached.
+     * @param  chunk Detached chunk whose jobs finished.
+     * @return Chunks dropped from the cache, to be destroyed by the caller.
+     */
+    auto ChunkCache::insert(std::unique_ptr<Chunk> chunk) -> std::vector<std::unique_ptr<Chunk>> {
+        std::vector<std::unique_ptr<Chunk>> evicted;
+
+        const u64 key = ChunkCache::key(chunk->coordinates());
+        const size_t bytes = chunk->memory();
+
+        if (auto it = this->index.find(key); it != this->index.end()) {
+            this->bytes -= it->second->bytes;
+            evicted.push_back(std::move(it->second->chunk));
+            this->order.erase(it->second);
+            this->index.erase(it);
+        }
+
+        if (bytes > this->budget) {
+            evicted.push_back(std::move(chunk));
+            return evicted;
+        }
+
+        this->order.push_front({ key, bytes, std::move(chunk) });
+        this->index[key] = this->order.begin();
+        this->bytes += bytes;
+
+        while (this->bytes > this->budget) {
+            auto &last = this->order.back();
+            this->bytes -= last.bytes;
+            this->index.erase(last.key);
+
+            evicted.push_back(std::move(last.chunk));
+            this->order.pop_back();
+        }
+
+        return evicted;
+    }
+
+    /**
+     * @brief  Removes the chunk at the coordinates from the cache, counts as a lookup.
+     * @param  coordinates World position of the chunk in units of chunks.
+     * @return The cached chunk or nullptr on a miss.
+     */
+    auto ChunkCache::take(glm::ivec2 coordinates) -> std::unique_ptr<Chunk> {
+        auto it = this->index.find(ChunkCache::key(coordinates));
+        if (it == this->index.end()) {
+            ++this->misses;
+            return nullptr;
+        }
+
+        auto chunk = std::move(it->second->chunk);
+        this->bytes -= it->second->bytes;
+        this->order.erase(it->second);
+        this->index.erase(it);
+
+        ++this->hits;
+        return chunk;
+    }
+
+    auto ChunkCache::contains(glm::ivec2 coordinates) const -> bool {
+        return this->index.contains(ChunkCache::key(coordinates));
+    }
+
+    auto ChunkCache::stats() const -> CacheStats {
+        return { this->hits, this->misses, this->bytes, this->order.size() };
+    }
+
+    auto ChunkCache::key(glm::ivec2 coordinates) -> u64 {
+        return (static_cast<u64>(static_cast<u32>(coordinates.x)) << SHIFT_HIGH) | static_cast<u32>(coordinates.y);
+    }
+}
@@ -0,0 +1,69 @@
+//
+// Created by Luis Ruisinger on 05.11.24.
+//
+
+#ifndef OPENGL_3D_ENGINE_CHUNK_CACHE_H
+#define OPENGL_3D_ENGINE_CHUNK_CACHE_H
+
+#include <list>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+#include "chunk.h"
+
+#include "../../../util/defines.h"
+
+// bytes of unloaded chunks kept for reuse, the least recently unloaded ones are dropped first
+#define CHUNK_CACHE_BUDGET (static_cast<size_t>(256) << 20)
+
+namespace core::level::chunk {
+
+    /** @brief Counters of the cache, lookups are made for every chunk entering the region */
+    struct CacheStats {
+        u64 hits;
+        u64 misses;
+        size_t bytes;
+        size_t entries;
+    };
+
+    /**
+     * @brief Unloaded chunks keyed by their coordinates, kept until the memory budget is exceeded.
+     *        A chunk leaving the region is reused as is if the region moves back, it keeps
+     *        its trees and its slot since the slot follows from the coordinates.
+     *        Only used by the tick thread, cached chunks have no neighbors.
+     */
+    class ChunkCache {
+    public:
+        explicit ChunkCache(size_t budget = CHUNK_CACHE_BUDGET);
+        ~ChunkCache() =default;
+
+        ChunkCache(const ChunkCache &) =delete;
+        auto operator=(const ChunkCache &) -> ChunkCache & =delete;
+
+        auto insert(std::unique_ptr<Chunk>) -> std::vector<std::unique_ptr<Chunk>>;
+        auto take(glm::ivec2) -> std::unique_ptr<Chunk>;
+        auto contains(glm::ivec2) const -> bool;
+        auto stats() const -> CacheStats;
+
+    private:
+        struct Entry {
+            u64 key;
+            size_t bytes;
+            std::unique_ptr<Chunk> chunk;
+        };
+
+        static auto key(glm::ivec2) -> u64;
+
+        // most recently unloaded chunk first
+        std::list<Entry> order;
+        std::unordered_map<u64, std::list<Entry>::iterator> index;
+
+        size_t budget;
+        size_t bytes { 0 };
+        u64 hits { 0 };
+        u64 misses { 0 };
+    };
+}
+
+#endif //OPENGL_3D_ENGINE_CHUNK_CACHE_H
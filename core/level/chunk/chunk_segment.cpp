@@ -6,18 +6,28 @@
 
 namespace core::level::chunk {
     ChunkSegment::ChunkSegment(u8 segmentIdx)
-        : voxel_root     { std::make_unique<octree::Octree>() },
-          water_root     { std::make_unique<octree::Octree>() },
+        : voxel_root     { std::make_shared<octree::Octree>() },
+          water_root     { std::make_shared<octree::Octree>() },
           chunk_modified { false                              },
           segment_idx    { segmentIdx                         }
     {}
 
     ChunkSegment::ChunkSegment(ChunkSegment &&other) noexcept
-        : voxel_root     { std::move(other.voxel_root)                       },
-          water_root     { std::move(other.water_root)                       },
-          chunk_modified { other.chunk_modified                              },
-          initialized    { other.initialized.load(std::memory_order_acquire) },
-          segment_idx    { other.segment_idx                                 }
+        : voxel_root        { std::move(other.voxel_root)                        },
+          water_root        { std::move(other.water_root)                        },
+          voxel_snapshot    { std::move(other.voxel_snapshot)                    },
+          water_snapshot    { std::move(other.water_snapshot)                    },
+          voxel_occupancy   { std::move(other.voxel_occupancy)                   },
+          water_occupancy   { std::move(other.water_occupancy)                   },
+          voxel_translucent { std::move(other.voxel_translucent)                 },
+          water_translucent { std::move(other.water_translucent)                 },
+          voxel_stream      { std::move(other.voxel_stream)                      },
+          water_stream      { std::move(other.water_stream)                      },
+          stream_dirty      { other.stream_dirty.load(std::memory_order_acquire) },
+          stream_level      { other.stream_level                                 },
+          chunk_modified    { other.chunk_modified                               },
+          initialized       { other.initialized.load(std::memory_order_acquire)  },
+          segment_idx       { other.segment_idx                                  }
     {
         other.chunk_modified = false;
     }
@@ -28,8 +38,101 @@ namespace core::level::chunk {
         this->initialized = other.initialized.load(std::memory_order_acquire);
         this->voxel_root = std::move(other.voxel_root);
         this->water_root = std::move(other.water_root);
+        this->voxel_snapshot = std::move(other.voxel_snapshot);
+        this->water_snapshot = std::move(other.water_snapshot);
+        this->voxel_occupancy = std::move(other.voxel_occupancy);
+        this->water_occupancy = std::move(other.water_occupancy);
+        this->voxel_translucent = std::move(other.voxel_translucent);
+        this->water_translucent = std::move(other.water_translucent);
+        this->voxel_stream = std::move(other.voxel_stream);
+        this->water_stream = std::move(other.water_stream);
+        this->stream_dirty = other.stream_dirty.load(std::memory_order_acquire);
+        this->stream_level = other.stream_level;
 
         other.chunk_modified = false;
         return *this;
     }
-}
\ No newline at end of file
+
+    /**
+     * @brief  Working tree for edits. A tree still shared with the published snapshot is
+     *         copied first, the render traversal keeps reading the unmodified version.
+     * @param  water Selects the water tree.
+     * @return The working tree.
+     */
+    auto ChunkSegment::tree(bool water) -> octree::Octree & {
+        auto &root = water ? this->water_root : this->voxel_root;
+        const auto &snapshot = water ? this->water_snapshot : this->voxel_snapshot;
+
+        // only the editing thread replaces the snapshot, comparing it needs no synchronization
+        if (root == snapshot)
+            root = snapshot->clone();
+
+        return *root;
+    }
+
+    /**
+     * @brief  Working tree for reads of the editing thread, never copied. As long as nothing
+     *         was edited since the last publish it is the published snapshot itself.
+     * @param  water Selects the water tree.
+     * @return The working tree.
+     */
+    auto ChunkSegment::tree(bool water) const -> const octree::Octree & {
+        return *(water ? this->water_root : this->voxel_root);
+    }
+
+    /**
+     * @brief  Immutable version of a tree for the render traversal, safe to read during edits.
+     *         The version stays alive as long as the returned pointer is held.
+     * @param  water Selects the water tree.
+     * @return The last published tree, nullptr if nothing was published yet.
+     */
+    auto ChunkSegment::snapshot(bool water) const -> std::shared_ptr<const octree::Octree> {
+        return std::atomic_load_explicit(
+                water ? &this->water_snapshot : &this->voxel_snapshot, std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Makes the edits of the working trees visible to the render traversal.
+     *        The replaced versions are freed once the last traversal reading them finished.
+     */
+    auto ChunkSegment::publish() -> void {
+        bool published = false;
+
+        for (auto [root, snapshot] : {
+                std::pair { &this->voxel_root, &this->voxel_snapshot },
+                std::pair { &this->water_root, &this->water_snapshot } }) {
+            if (*root == *snapshot)
+                continue;
+
+            std::atomic_store_explicit(
+                    snapshot, std::shared_ptr<const octree::Octree> { *root }, std::memory_order_release);
+            published = true;
+        }
+
+        // the cached faces were built from the previous version
+        if (published)
+            this->stream_dirty.store(true, std::memory_order_release);
+    }
+
+    /**
+     * @brief Marks a box of the segment as occupied by a single tile.
+     * @param water       Selects the water occupancy.
+     * @param min         Inclusive corner of the box in segment coordinates.
+     * @param max         Exclusive corner of the box in segment coordinates.
+     * @param translucent Boolean indicating if the tile hides less than the default tile of its tree.
+     */
+    auto ChunkSegment::occupy(bool water, glm::ivec3 min, glm::ivec3 max, bool translucent) -> void {
+        auto &occupancy = water ? this->water_occupancy : this->voxel_occupancy;
+        auto &translucency = water ? this->water_translucent : this->voxel_translucent;
+
+        const i32 width = max.x - min.x;
+        const u32 mask = (width == CHUNK_SIZE ? UINT32_MAX : (1u << width) - 1) << min.x;
+
+        for (i32 y = min.y; y < max.y; ++y) {
+            for (i32 z = min.z; z < max.z; ++z) {
+                occupancy.write(y, z, mask, true);
+                translucency.write(y, z, mask, translucent);
+            }
+        }
+    }
+}
@@ -12,6 +12,7 @@
 
 #include "../../../util/defines.h"
 #include "../chunk_data_structure/octree.h"
+#include "occupancy.h"
 
 namespace core::level::platform {
     class Platform;
@@ -22,6 +23,13 @@ namespace core::level::chunk {
 }
 
 namespace core::level::chunk {
+
+    /** @brief Visible faces of a tree grouped by face index, offsets delimit the groups */
+    struct FaceStream {
+        std::vector<u64> faces;
+        std::array<u32, 7> offsets {};
+    };
+
     class ChunkSegment {
         friend Chunk;
 
@@ -36,11 +44,41 @@ namespace core::level::chunk {
         auto operator=(ChunkSegment &other) -> ChunkSegment & = delete;
 
     private:
+        auto tree(bool) -> octree::Octree &;
+        auto tree(bool) const -> const octree::Octree &;
+        auto snapshot(bool) const -> std::shared_ptr<const octree::Octree>;
+        auto publish() -> void;
+        auto occupy(bool, glm::ivec3, glm::ivec3, bool) -> void;
+
         // -------------------------------------------
         // underlying chunk_data_structure, managing the cubic space
+        // the working trees are edited, the render traversal only reads the published snapshots
+        // both share the same tree until the first edit after publishing copies it
+
+        std::shared_ptr<octree::Octree> voxel_root;
+        std::shared_ptr<octree::Octree> water_root;
+
+        std::shared_ptr<const octree::Octree> voxel_snapshot;
+        std::shared_ptr<const octree::Octree> water_snapshot;
+
+        // -------------------------------------------
+        // occupied positions of both trees, answering point queries in O(1)
+
+        Occupancy voxel_occupancy;
+        Occupancy water_occupancy;
+
+        // occupied positions whose tile does not hide what the default tile of its tree hides
+
+        Occupancy voxel_translucent;
+        Occupancy water_translucent;
+
+        // -------------------------------------------
+        // cached faces of both trees, rebuilt when the trees or the detail level changed
 
-        std::unique_ptr<octree::Octree> voxel_root;
-        std::unique_ptr<octree::Octree> water_root;
+        FaceStream voxel_stream;
+        FaceStream water_stream;
+        std::atomic_bool stream_dirty = true;
+        u8 stream_level = 0;
 
         // ------------------------------------------------------------
         // indicator if the segment got manipulated (for serialization)
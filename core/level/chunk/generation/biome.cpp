@@ -20,14 +20,14 @@ namespace core::level::chunk::generation::biome {
         auto max_y = std::min(static_cast<i32>(m + WATER_LEVEL), max_height);
         for (auto y = max_y + 1; y < WATER_LEVEL; ++y) {
             auto pos = glm::ivec3{x, y, z};
-            chunk.insert<rendering::renderer::RenderType::WATER_RENDERER>(
-                    pos, tiles::tile::WATER, false);
+            chunk.stage<rendering::renderer::RenderType::WATER_RENDERER>(
+                    pos, tiles::tile::WATER);
         }
 
         for (auto y = 0; y <= max_y; ++y) {
             auto pos = glm::ivec3{x, y, z};
-            chunk.insert<rendering::renderer::RenderType::CHUNK_RENDERER>(
-                    pos, tiles::tile::STONE, false);
+            chunk.stage<rendering::renderer::RenderType::CHUNK_RENDERER>(
+                    pos, tiles::tile::STONE);
         }
     }
 
@@ -46,14 +46,14 @@ namespace core::level::chunk::generation::biome {
         auto max_y = std::min(static_cast<i32>(m + WATER_LEVEL), max_height);
         for (auto y = max_y - 3; y <= max_y; ++y) {
             auto pos = glm::ivec3 { x, y, z };
-            chunk.insert<rendering::renderer::RenderType::CHUNK_RENDERER>(
-                    pos, tiles::tile::GRASS, false);
+            chunk.stage<rendering::renderer::RenderType::CHUNK_RENDERER>(
+                    pos, tiles::tile::GRASS);
         }
 
         for (auto y = 0; y < max_y - 3; ++y) {
             auto pos = glm::ivec3 { x, y, z };
-            chunk.insert<rendering::renderer::RenderType::CHUNK_RENDERER>(
-                    pos, tiles::tile::STONE, false);
+            chunk.stage<rendering::renderer::RenderType::CHUNK_RENDERER>(
+                    pos, tiles::tile::STONE);
         }
     }
 
@@ -0,0 +1,137 @@
+//
+// Created by Luis Ruisinger on 04.11.24.
+//
+
+#include <algorithm>
+
+#include "greedy_faces.h"
+#include "../chunk_data_structure/node_inline.h"
+
+namespace core::level::chunk::greedy {
+
+    /** @brief Axis (x, y, z) the normal of a face index points along */
+    static constexpr const u8 normal_axis[6] = { 2, 2, 1, 1, 0, 0 };
+
+    /** @brief Indicates the normal of a face index points into the positive direction */
+    static constexpr const bool normal_positive[6] = { false, true, false, true, true, false };
+
+    /** @brief Offsets of the x, y and z coordinate inside the high 32 bit */
+    static constexpr const u8 shifts[3] = { 0xD, 0x8, 0x3 };
+
+    /** @brief Marks a covered cell, the bits 8 to 15 of an emitted face are always cleared */
+    static constexpr const u32 covered = 0x100;
+
+    /** @brief Start of every level of the quadtree over a plane, level k holds (32 >> k)^2 cells */
+    static constexpr const u32 level_offsets[6] = { 0, 1024, 1280, 1344, 1360, 1364 };
+
+    auto merge(std::array<std::vector<u64>, 6> &faces) -> void {
+        thread_local std::array<std::vector<u64>, CHUNK_SIZE + 1> planes;
+        thread_local std::array<u32, 1365> cells {};
+
+        for (u8 i = 0; i < faces.size(); ++i) {
+            auto &stream = faces[i];
+            if (stream.size() < 2)
+                continue;
+
+            const u8 n = normal_axis[i];
+            const u8 u = (n + 1) % 3;
+            const u8 v = (n + 2) % 3;
+            const bool positive = normal_positive[i];
+
+            // minimum corner of the volume a face belongs to along an axis
+            auto min = [](u32 high, u8 axis) -> i32 {
+                const u8 exponent = high & MASK_3;
+                const i32 half = exponent ? (1 << (exponent - 1)) : 0;
+                return static_cast<i32>((high >> shifts[axis]) & MASK_5) - half;
+            };
+
+            // bucketing the faces by the plane they lie on
+            for (const u64 face : stream) {
+                const u32 high = face >> SHIFT_HIGH;
+                const i32 plane = min(high, n) + (positive ? (1 << (high & MASK_3)) : 0);
+                planes[plane].push_back(face);
+            }
+
+            stream.clear();
+
+            for (i32 plane = 0; plane < static_cast<i32>(planes.size()); ++plane) {
+                auto &bucket = planes[plane];
+
+                if (bucket.size() < 2) {
+                    stream.insert(stream.end(), bucket.begin(), bucket.end());
+                    bucket.clear();
+                    continue;
+                }
+
+                for (const u64 face : bucket) {
+                    const u32 high = face >> SHIFT_HIGH;
+                    const i32 edge = 1 << (high & MASK_3);
+                    const i32 min_u = min(high, u);
+                    const i32 min_v = min(high, v);
+                    const u32 tile = static_cast<u32>(face) | covered;
+
+                    for (i32 a = min_u; a < min_u + edge; ++a)
+                        for (i32 b = min_v; b < min_v + edge; ++b)
+                            cells[a * CHUNK_SIZE + b] = tile;
+                }
+
+                bucket.clear();
+
+                // a cell of a level is uniform if its 4 children are uniform with the same tile
+                for (u8 k = 1; k < 6; ++k) {
+                    const u32 size = CHUNK_SIZE >> k;
+                    const u32 *children = &cells[level_offsets[k - 1]];
+
+                    for (u32 a = 0; a < size; ++a) {
+                        for (u32 b = 0; b < size; ++b) {
+                            const u32 c = children[(2 * a) * (2 * size) + 2 * b];
+                            const bool uniform =
+                                    c == children[(2 * a) * (2 * size) + 2 * b + 1] &&
+                                    c == children[(2 * a + 1) * (2 * size) + 2 * b] &&
+                                    c == children[(2 * a + 1) * (2 * size) + 2 * b + 1];
+
+                            cells[level_offsets[k] + a * size + b] = uniform ? c : 0;
+                        }
+                    }
+                }
+
+                // emitting the largest uniform squares whose virtual cube is addressable
+                auto emit = [&](auto &self, u8 k, u32 a, u32 b) -> void {
+                    const u32 tile = cells[level_offsets[k] + a * (CHUNK_SIZE >> k) + b];
+                    const i32 edge = 1 << k;
+                    const i32 half = edge >> 1;
+
+                    // the cube is addressed by its center, leaves by their minimum corner
+                    const i32 normal = k
+                            ? (positive ? plane - half : plane + half)
+                            : (positive ? plane - 1 : plane);
+
+                    if (tile && normal >= 0 && normal <= MASK_5) {
+                        std::array<u32, 3> position;
+                        position[n] = normal;
+                        position[u] = a * edge + half;
+                        position[v] = b * edge + half;
+
+                        const u32 high =
+                                (position[0] << shifts[0]) |
+                                (position[1] << shifts[1]) |
+                                (position[2] << shifts[2]) |
+                                k;
+
+                        stream.push_back((static_cast<u64>(high) << SHIFT_HIGH) | (tile & ~covered));
+                        return;
+                    }
+
+                    if (!k)
+                        return;
+
+                    for (u8 c = 0; c < 4; ++c)
+                        self(self, k - 1, 2 * a + (c >> 1), 2 * b + (c & 0x1));
+                };
+
+                emit(emit, 5, 0, 0);
+                std::fill(cells.begin(), cells.end(), 0);
+            }
+        }
+    }
+}
@@ -0,0 +1,31 @@
+//
+// Created by Luis Ruisinger on 04.11.24.
+//
+
+#ifndef OPENGL_3D_ENGINE_GREEDY_FACES_H
+#define OPENGL_3D_ENGINE_GREEDY_FACES_H
+
+#include <array>
+#include <vector>
+
+#include "../../../util/defines.h"
+
+// merges coplanar faces of the same tile before the faces of a segment are cached
+#define CHUNK_GREEDY_FACES 1
+
+namespace core::level::chunk::greedy {
+
+    /**
+     * @brief Merges coplanar faces with the same tile into the largest aligned squares.
+     *
+     * A square of 2^n voxels is emitted as the face of a virtual cube with the exponent n,
+     * placed such that the face lies on the plane of the merged faces. This is the same
+     * packing recombined cubes are drawn with, the vertex layout stays untouched.
+     * Squares whose virtual cube can not be addressed are split further.
+     *
+     * @param faces Packed faces of a segment per face index, replaced by the merged faces.
+     */
+    auto merge(std::array<std::vector<u64>, 6> &faces) -> void;
+}
+
+#endif //OPENGL_3D_ENGINE_GREEDY_FACES_H
@@ -0,0 +1,33 @@
+//
+// Created by Luis Ruisinger on 19.10.24.
+//
+
+#include "occupancy.h"
+
+#include "../chunk_data_structure/node_kernels.h"
+
+namespace core::level::chunk {
+
+    /**
+     * @brief Computes the exposed faces of every occupied voxel of a volume in one sweep.
+     *        A face is exposed if the voxel next to it can not hide it. Rows along x are
+     *        shifted by one bit for the x faces, the y and z faces read the neighboring rows.
+     *        The sweep is a kernel of node_kernels, chosen with the others at startup.
+     * @param occupancy Rows of the voxels whose faces are computed.
+     * @param cullers   Rows of the voxels able to hide a face, the border holds the adjacent
+     *                  rows of the neighboring volumes below, above, at -z and at +z.
+     * @param x_neg     Culler rows of the volume at -x, only bit 31 is read.
+     * @param x_pos     Culler rows of the volume at +x, only bit 0 is read.
+     * @param faces     Rows of voxels with an exposed face, ordered LEFT, RIGHT, TOP, BOTTOM,
+     *                  FRONT and BACK like the face bits.
+     */
+    auto Occupancy::expose(
+            const Rows &occupancy,
+            const Padded &cullers,
+            const Rows &x_neg,
+            const Rows &x_pos,
+            std::array<Rows, 6> &faces)
+            -> void {
+        node_kernels::kernels.expose(occupancy, cullers, x_neg, x_pos, faces);
+    }
+}
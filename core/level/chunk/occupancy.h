@@ -0,0 +1,93 @@
+//
+// Created by Luis Ruisinger on 19.10.24.
+//
+
+#ifndef OPENGL_3D_ENGINE_OCCUPANCY_H
+#define OPENGL_3D_ENGINE_OCCUPANCY_H
+
+#include <memory>
+#include <array>
+
+#include "../../../util/defines.h"
+
+namespace core::level::chunk {
+
+    /**
+     * @brief Dense bit volume of a 32^3 segment, one bit per voxel.
+     *        Every (y, z) pair owns a row of 32 voxels along x, bit x is set if occupied.
+     *        The 4 KiB of rows are only allocated once the first voxel is set.
+     */
+    class Occupancy {
+    public:
+        using Rows = std::array<u32, CHUNK_SIZE * CHUNK_SIZE>;
+
+        /** @brief Rows with a border of one row on every side, indexed by (y + 1) * (CHUNK_SIZE + 2) + z + 1 */
+        using Padded = std::array<u32, (CHUNK_SIZE + 2) * (CHUNK_SIZE + 2)>;
+
+        Occupancy() =default;
+        ~Occupancy() =default;
+
+        Occupancy(Occupancy &&) noexcept =default;
+        auto operator=(Occupancy &&) noexcept -> Occupancy & =default;
+
+        Occupancy(const Occupancy &) =delete;
+        auto operator=(const Occupancy &) =delete;
+
+        static auto expose(
+                const Rows &,
+                const Padded &,
+                const Rows &,
+                const Rows &,
+                std::array<Rows, 6> &)
+                -> void;
+
+        inline auto test(u8 x, u8 y, u8 z) const -> bool {
+            return this->rows && (((*this->rows)[y * CHUNK_SIZE + z] >> x) & 0x1);
+        }
+
+        inline auto set(u8 x, u8 y, u8 z) -> void {
+            if (!this->rows)
+                this->rows = std::make_unique<Rows>();
+
+            (*this->rows)[y * CHUNK_SIZE + z] |= static_cast<u32>(0x1) << x;
+        }
+
+        inline auto reset(u8 x, u8 y, u8 z) -> void {
+            if (this->rows)
+                (*this->rows)[y * CHUNK_SIZE + z] &= ~(static_cast<u32>(0x1) << x);
+        }
+
+        /** @brief Sets or resets the x-bits of a mask inside the row at (y, z) */
+        inline auto write(u8 y, u8 z, u32 mask, bool value) -> void {
+            if (!value) {
+                if (this->rows)
+                    (*this->rows)[y * CHUNK_SIZE + z] &= ~mask;
+                return;
+            }
+
+            if (!this->rows)
+                this->rows = std::make_unique<Rows>();
+
+            (*this->rows)[y * CHUNK_SIZE + z] |= mask;
+        }
+
+        /** @brief Row of x-bits at (y, z), 0 for an unallocated volume */
+        inline auto row(u8 y, u8 z) const -> u32 {
+            return this->rows ? (*this->rows)[y * CHUNK_SIZE + z] : 0;
+        }
+
+        /** @brief All rows indexed by y * CHUNK_SIZE + z, nullptr if nothing was ever set */
+        inline auto data() const -> const Rows * {
+            return this->rows.get();
+        }
+
+        inline auto clear() -> void {
+            this->rows.reset();
+        }
+
+    private:
+        std::unique_ptr<Rows> rows;
+    };
+}
+
+#endif //OPENGL_3D_ENGINE_OCCUPANCY_H
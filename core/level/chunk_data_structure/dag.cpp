@@ -0,0 +1,175 @@
+//
+// Created by Luis Ruisinger on 21.10.24.
+//
+
+#include <mutex>
+
+#include "dag.h"
+#include "node_inline.h"
+
+namespace core::level::dag {
+
+    /**
+     * @brief  Hashes the content of a block, child indices are part of the key.
+     *         Children are interned before their parent, equal subtrees thus have equal keys.
+     * @param  block The block to hash.
+     * @return 64 bit hash of the block.
+     */
+    static auto hash(const node::NodePool::Block &block) -> u64 {
+        u64 h = 0xCBF29CE484222325;
+
+        for (const auto &node : block) {
+            h = (h ^ node.packed_data) * 0x100000001B3;
+            h = (h ^ node.nodes) * 0x100000001B3;
+            h ^= h >> 0x20;
+        }
+
+        return h;
+    }
+
+    static auto equal(const node::NodePool::Block &a, const node::NodePool::Block &b) -> bool {
+        for (u8 i = 0; i < 8; ++i)
+            if (a[i].packed_data != b[i].packed_data || a[i].nodes != b[i].nodes)
+                return false;
+
+        return true;
+    }
+
+    /**
+     * @brief Moves the subtree below a node into the store.
+     *        The children of the node are replaced by a shared block, the private pool
+     *        is left untouched and can be cleared afterwards.
+     * @param node The node whose children are interned, its child index is rewritten.
+     * @param pool The private pool the children currently live in.
+     */
+    auto Dag::intern(node::Node &node, const node::NodePool &pool) -> void {
+        std::unique_lock lock { this->mutex };
+        intern_block(node, pool);
+    }
+
+    auto Dag::intern_block(node::Node &node, const node::NodePool &pool) -> void {
+        const u8 segments = node.packed_data >> 0x38;
+        if (!segments) {
+            node.nodes = 0;
+            return;
+        }
+
+        // canonical copy, unused slots are cleared
+        node::NodePool::Block block {};
+        for (u8 i = 0; i < 8; ++i) {
+            if (!(segments & (1 << i)))
+                continue;
+
+            block[i].packed_data = pool[node.nodes][i].packed_data;
+            block[i].nodes       = pool[node.nodes][i].nodes;
+            intern_block(block[i], pool);
+        }
+
+        const u64 key = hash(block);
+        if (const auto it = this->index.find(key);
+            it != this->index.end() && equal(this->blocks[it->second], block)) {
+
+            // the existing block already holds references on the same children
+            for (u8 i = 0; i < 8; ++i)
+                if (block[i].packed_data >> 0x38)
+                    release_block(block[i].nodes);
+
+            ++this->references[it->second];
+            node.nodes = it->second;
+            return;
+        }
+
+        const u32 shared = this->blocks.allocate();
+        this->blocks[shared] = std::move(block);
+
+        if (shared >= this->references.size())
+            this->references.resize(shared + 1);
+
+        this->references[shared] = 1;
+        this->index.try_emplace(key, shared);
+
+        node.nodes = shared;
+    }
+
+    /**
+     * @brief Drops the reference of a node on its shared children.
+     * @param node The node whose children were interned.
+     */
+    auto Dag::release(const node::Node &node) -> void {
+        std::unique_lock lock { this->mutex };
+
+        if (node.packed_data >> 0x38)
+            release_block(node.nodes);
+    }
+
+    auto Dag::release_block(u32 shared) -> void {
+        if (--this->references[shared])
+            return;
+
+        const auto &block = this->blocks[shared];
+        for (const auto &child : block)
+            if (child.packed_data >> 0x38)
+                release_block(child.nodes);
+
+        if (const auto it = this->index.find(hash(block));
+            it != this->index.end() && it->second == shared) {
+            this->index.erase(it);
+        }
+
+        this->blocks.release(shared);
+    }
+
+    /**
+     * @brief Copies a shared subtree back into a private pool to make it modifiable.
+     *        Chunk information is not restored.
+     * @param node The node whose children are interned.
+     * @param out  Receives the copy of the node.
+     * @param pool The private pool receiving the children.
+     */
+    auto Dag::expand(const node::Node &node, node::Node &out, node::NodePool &pool) const -> void {
+        std::shared_lock lock { this->mutex };
+        expand_block(node, out, pool);
+    }
+
+    auto Dag::expand_block(const node::Node &node, node::Node &out, node::NodePool &pool) const -> void {
+        const u8 segments = node.packed_data >> 0x38;
+
+        out.packed_data = node.packed_data;
+        out.nodes = 0;
+
+        if (!segments)
+            return;
+
+        // the pool may grow while the children are copied, the block is addressed by index
+        const u32 block = pool.allocate();
+        for (u8 i = 0; i < 8; ++i) {
+            if (!(segments & (1 << i)))
+                continue;
+
+            node::Node child {};
+            expand_block(this->blocks[node.nodes][i], child, pool);
+            pool[block][i] = std::move(child);
+        }
+
+        out.nodes = block;
+    }
+
+    auto Dag::lock() const -> std::shared_lock<std::shared_mutex> {
+        return std::shared_lock { this->mutex };
+    }
+
+    auto Dag::pool() const -> const node::NodePool & {
+        return this->blocks;
+    }
+
+    /** @brief Amount of distinct blocks shared by all trees. */
+    auto Dag::size() const -> size_t {
+        std::shared_lock lock { this->mutex };
+        return this->blocks.size();
+    }
+
+    auto instance() -> Dag & {
+        static Dag dag;
+        return dag;
+    }
+}
@@ -0,0 +1,61 @@
+//
+// Created by Luis Ruisinger on 21.10.24.
+//
+
+#ifndef OPENGL_3D_ENGINE_DAG_H
+#define OPENGL_3D_ENGINE_DAG_H
+
+#include <unordered_map>
+#include <shared_mutex>
+#include <vector>
+
+#include "node.h"
+
+#include "../../../util/defines.h"
+
+// shares identical subtrees of all trees once a chunk is compressed
+#define OCTREE_DAG 0
+
+namespace core::level::dag {
+
+    /**
+     * @brief Store of child blocks shared between all trees.
+     *        Blocks are hash-consed bottom up, identical subtrees of different segments and
+     *        chunks end up as the same block and are reference counted. Nodes inside the store
+     *        carry no chunk information, it is added when the faces are emitted.
+     *        Readers traverse under a shared lock, interning and releasing take the lock exclusively.
+     */
+    class Dag {
+    public:
+        Dag() =default;
+        ~Dag() =default;
+
+        Dag(const Dag &) =delete;
+        auto operator=(const Dag &) -> Dag & =delete;
+
+        auto intern(node::Node &, const node::NodePool &) -> void;
+        auto release(const node::Node &) -> void;
+        auto expand(const node::Node &, node::Node &, node::NodePool &) const -> void;
+
+        auto lock() const -> std::shared_lock<std::shared_mutex>;
+        auto pool() const -> const node::NodePool &;
+        auto size() const -> size_t;
+
+    private:
+        auto intern_block(node::Node &, const node::NodePool &) -> void;
+        auto release_block(u32) -> void;
+        auto expand_block(const node::Node &, node::Node &, node::NodePool &) const -> void;
+
+        node::NodePool blocks;
+        std::vector<u32> references;
+
+        // hash of a block to its index, colliding blocks are stored without being shared
+        std::unordered_map<u64, u32> index;
+
+        mutable std::shared_mutex mutex;
+    };
+
+    auto instance() -> Dag &;
+}
+
+#endif //OPENGL_3D_ENGINE_DAG_H
@@ -8,6 +8,7 @@
 #endif
 
 #include <cmath>
+#include <cstring>
 
 #include "node_inline.h"
 #include "../chunk/chunk_renderer.h"
@@ -15,10 +16,6 @@
 
 namespace core::level::node {
 
-    /** @brief Mask to extract packed data without the packed chunk information. */
-    static constexpr const u64 mask_off_chunk =
-            (UINT64_MAX << SHIFT_HIGH) | static_cast<u64>(UINT16_MAX);
-
     /** @brief Mask to transform a vertex point to a face. */
     static constexpr const u64 vertex_clear_mask = 0x0003FFFFFFFF00FFU;
 
@@ -26,49 +23,37 @@ namespace core::level::node {
     //static const model::voxel::CubeStructure cube_structure = {};
 
     /**
-     * @brief  Updates the mask inside the packed voxel data and recursivly builds a face mask.
-     * @param  mask Packed chunk data containing chunk offset and chunksegment offset.
+     * @brief  Recursivly builds a face mask.
+     * @param  pool Pool containing the child blocks of the tree.
      * @return Face mask for the current cubic area.
      */
-    auto Node::update_face_mask(u16 mask) -> u8 {
+    auto Node::update_face_mask(NodePool &pool) -> u8 {
         u8 faces = 0;
         u8 segments = this->packed_data >> 56;
 
-        this->packed_data = (this->packed_data & mask_off_chunk) | (static_cast<u64>(mask) << 16);
         if (!segments)
             return static_cast<u8>((this->packed_data >> 50) & MASK_6);
 
         for (u8 i = 0; i < 8; ++i)
             if (segments & (1 << i))
-                faces |= this->nodes->operator[](i).update_face_mask(mask);
+                faces |= pool[this->nodes][i].update_face_mask(pool);
 
         this->packed_data |= static_cast<u64>(faces) << 50;
         return faces;
     }
 
     /**
-     * @brief Updates the mask inside the packed voxel data.
-     *        Happens when chunks are moved in another loaded area.
-     * @param mask Packed chunk data containing chunk offset and chunksegment offset.
-     */
-    auto Node::update_chunk_mask(u16 mask) -> void {
-        this->packed_data = (this->packed_data & mask_off_chunk) | (static_cast<u64>(mask) << 16);
-
-        u8 segments = this->packed_data >> 56;
-        for (u8 i = 0; i < 8; ++i)
-            if (segments & (1 << i))
-                this->nodes->operator[](i).update_chunk_mask(mask);
-    }
-
-    /**
-     * @brief Recombines the underlying chunk_data_structure to a SVO.
-     *        Cubic areas of equal voxels will be combined to a bigger voxel.
-     *        Therefore we would traverse less nodes and can destroy children
-     *        (which represent smaller areas / voxels).
-     * @param stack
+     * @brief  Recombines the subtree of a node with the kernels of the executing cpu.
+     *         Leaves are only final once their parent did not combine, thus the parent
+     *         counts its leaf children and a combined volume is counted by its own parent.
+     * @tparam K     Kernels of the executing cpu, see node_kernels::dispatch.
+     * @param  node  Root of the subtree.
+     * @param  pool  Pool containing the child blocks of the tree.
+     * @param  masks Final leaves below the node counted per face mask.
      */
-    auto Node::recombine() -> void {
-        u8 segments = this->packed_data >> 56;
+    template <const node_kernels::Kernels &K>
+    static auto recombine(Node &node, NodePool &pool, std::array<u32, 64> &masks) -> void {
+        u8 segments = node.packed_data >> 56;
 
         // removing unnecessary nodes containing <= 1 child
         // traversal path to leaves will be shorter
@@ -76,163 +61,303 @@ namespace core::level::node {
         if (!(segments & (segments - 1))) {
             for (u8 i = 0; i < 8; ++i)
                 if (segments & (1 << i)) {
-                    this->packed_data = this->nodes->operator[](i).packed_data;
-                    this->nodes = std::move(this->nodes->operator[](i).nodes);
+                    const auto block = node.nodes;
+                    node.packed_data = pool[block][i].packed_data;
+                    node.nodes = pool[block][i].nodes;
+                    pool.release(block);
 
-                    segments = this->packed_data >> 56;
+                    segments = node.packed_data >> 56;
                     break;
                 }
         }
 
-        // recombine children
+        // recombine children, leaves have nothing to recombine
         for (u8 i = 0; i < 8; ++i)
-            if (segments & (1 << i))
-                this->nodes->operator[](i).recombine();
+            if ((segments & (1 << i)) && (pool[node.nodes][i].packed_data >> 56))
+                recombine<K>(pool[node.nodes][i], pool, masks);
 
         // checks if all children equal each other
-        if (!node_inline::check_combinable(this))
+        // otherwise the node keeps a representative voxelID for its distant single cube
+        if (!node_inline::check_combinable<K>(&node, pool)) {
+            if (!segments)
+                return;
+
+            const auto &children = pool[node.nodes];
+            for (u8 i = 0; i < 8; ++i)
+                if ((segments & (1 << i)) && !(children[i].packed_data >> 56) && children[i].packed_data)
+                    ++masks[(children[i].packed_data >> 50) & MASK_6];
+
+            node.packed_data = (node.packed_data & ~static_cast<u64>(MASK_VOXEL_ID)) |
+                               node_inline::representative(children, segments);
             return;
+        }
 
         // deleting highest 14 bit and lowest 9 bit
         // deletes segments indicating no sub areas follow
         // deletes dirty faces the recalculate them in an higher order volume
         // deletes dirty voxel_ID to assign one of the subareas
-        this->packed_data &= (UINT64_MAX >> 14) & (UINT64_MAX << 9);
-        this->packed_data |= node_inline::combine_faces(this);
-        this->packed_data |= this->nodes->operator[](0).packed_data & MASK_VOXEL_ID;
+        node.packed_data &= (UINT64_MAX >> 14) & (UINT64_MAX << 9);
+        node.packed_data |= node_inline::combine_faces<K>(&node, pool);
+        node.packed_data |= pool[node.nodes][0].packed_data & MASK_VOXEL_ID;
 
         // reset nodes
-        this->nodes = {};
+        pool.release(node.nodes);
+        node.nodes = 0;
     }
 
     /**
-     * @brief Builds mesh through extraction of visible faces.
-     * @param args
-     * @param type Frustum intersection type used to determine
-     *             if we need to test against the frustum.
+     * @brief Recombines the underlying chunk_data_structure to a SVO.
+     *        Cubic areas of equal voxels will be combined to a bigger voxel.
+     *        Therefore we would traverse less nodes and can destroy children
+     *        (which represent smaller areas / voxels).
+     * @param  pool Pool containing the child blocks of the tree.
+     * @return Histogram of the visible faces of the recombined subtree.
      */
-    auto Node::cull(Args &args, util::culling::CollisionType type) const -> void {
-        const u64 faces = (this->packed_data >> 50) & static_cast<u64>(args._camera.get_mask());
-        if (!faces)
-            return;
-
-        // frustum check
-        if (((this->packed_data & node_inline::exponent_and) > node_inline::exponent_check) &&
-            (type == util::culling::INTERSECT)) {
-            const auto scale = 1 << ((this->packed_data >> SHIFT_HIGH) & MASK_3);
-            auto position = glm::vec3 {
-                    (this->packed_data >> 45) & MASK_5,
-                    (this->packed_data >> 40) & MASK_5,
-                    (this->packed_data >> 35) & MASK_5
-            };
-            position += glm::vec3(args._point);
-
-            if ((type = args._camera.frustum_collision(position, scale)) ==
-                util::culling::CollisionType::OUTSIDE) {
-                return;
-            }
+    auto Node::recombine(NodePool &pool) -> Histogram {
+        std::array<u32, 64> masks {};
+        node_kernels::dispatch([&]<const node_kernels::Kernels &K>() -> void {
+            node::recombine<K>(*this, pool, masks);
+        });
+
+        // the root has no parent to count it once it became a single leaf
+        if (!(this->packed_data >> 56) && this->packed_data)
+            ++masks[(this->packed_data >> 50) & MASK_6];
+
+        // a single increment per leaf, the faces are only split up once per tree
+        Histogram histogram {};
+        for (u8 mask = 0; mask < 64; ++mask) {
+            for (u8 i = 0; i < 6; ++i)
+                histogram.faces[i] += ((mask >> i) & 0x1) * masks[mask];
+
+            histogram.visible += std::popcount(mask) * masks[mask];
+            histogram.leaves  += masks[mask];
         }
 
-        auto segments = this->packed_data >> 56;
-        if (segments) {
-            for (u8 i = 0; i < 8; ++i) {
-                if (segments & (1 << i)) {
-                    this->nodes->operator[](i).cull(args, type);
-                }
-            }
-        }
-        else {
-            ASSERT_EQ(faces);
+        return histogram;
+    }
 
-            #ifdef __AVX2__
-            __m256i voxelVec = _mm256_set1_epi64x(this->packed_data & vertex_clear_mask);
+    /**
+     * @brief Collects the visible faces of every leaf, independent of camera and frustum.
+     *        Inner nodes with an exponent of at most level are collected as a single cube
+     *        with their combined faces and representative voxelID instead of descending.
+     * @param pool  Pool containing the child blocks of the tree.
+     * @param faces Receives the packed face data per face index.
+     * @param level Detail level, 0 collects every leaf.
+     */
+    auto Node::stream(const NodePool &pool, std::array<std::vector<u64>, 6> &faces, u8 level) const -> void {
+        const u8 mask = (this->packed_data >> 50) & MASK_6;
+        if (!mask)
+            return;
 
-            for (size_t i = 0; i < 6; ++i) {
+        auto segments = this->packed_data >> 56;
+        if (segments && ((this->packed_data >> SHIFT_HIGH) & MASK_3) > level) {
+            for (u8 i = 0; i < 8; ++i)
+                if (segments & (1 << i))
+                    pool[this->nodes][i].stream(pool, faces, level);
 
-                // we often only see 1 face
-                if (faces & (1 << i)) [[unlikely]] {
-                    __m256i vertexVec = _mm256_or_si256(model::voxel::cube_structure.mesh()[i], voxelVec);
-                    _mm256_store_si256(
-                            const_cast<__m256i *>(&args._voxelVec[args.actual_size]),
-                            vertexVec);
+            return;
+        }
 
-                    ++args.actual_size;
-                }
-            }
+        for (u8 i = 0; i < 6; ++i)
+            if (mask & (1 << i))
+                faces[i].push_back(this->packed_data & vertex_clear_mask);
+    }
 
-            #else
-            packedVoxel &= mask;
+    /**
+     * @brief  Replaces the faces of every leaf and rebuilds the faces of the inner nodes
+     *         as the union of their children.
+     * @param  pool Pool containing the child blocks of the tree.
+     * @param  fun  Yields the faces of a leaf from its packed data.
+     * @return Non-shifted face mask of the node.
+     */
+    auto Node::resolve_faces(NodePool &pool, const std::function<u64(u64)> &fun) -> u8 {
+        u8 segments = this->packed_data >> 56;
+        u64 faces = 0;
 
-            for (size_t i = 0; i < 6; ++i) {
-                if (faces & (1 << i)) [[unlikely]] {
-                    auto &face = cube_structure.mesh()[i];
+        // node default init without any content
+        if (!this->packed_data)
+            return 0;
 
-                    for (auto vertex : face)
-                        args._voxelVec.emplace_back(vertex | packedVoxel);
-                }
-            }
-            #endif
+        if (!segments) {
+            faces = fun(this->packed_data) & SET_FACES;
         }
+        else {
+            for (u8 i = 0; i < 8; ++i)
+                if (segments & (1 << i))
+                    faces |= static_cast<u64>(pool[this->nodes][i].resolve_faces(pool, fun)) << 50;
+        }
+
+        this->packed_data = (this->packed_data & ~SET_FACES) | faces;
+        return static_cast<u8>(faces >> 50);
     }
 
     /**
-     * @brief  Masks the leafs and increments a counter if mask contains bitmask.
-     * @param  mask The bitmask to test leaves against.
-     * @return Counter how many leaves contain the bitmask.
+     * @brief  Counts the visible faces of all leaves in a single pass.
+     * @param  pool Pool containing the child blocks of the tree.
+     * @return Histogram of the faces below the node.
      */
-    auto Node::count_mask(u64 mask) -> size_t {
-        auto sum = 0;
+    auto Node::histogram(const NodePool &pool) const -> Histogram {
+        Histogram histogram {};
         auto segments = this->packed_data >> 56;
 
         if (segments) {
             for (auto i = 0; i < 8; ++i)
                 if (segments & (1 << i))
-                    sum += this->nodes->operator[](i).count_mask(mask);
+                    histogram += pool[this->nodes][i].histogram(pool);
         }
-        else {
-            for (auto i = 0; i < 6; ++i)
-                if (this->packed_data & mask)
-                    ++sum;
+        else if (this->packed_data) {
+            histogram.add(this->packed_data);
         }
 
-        return sum;
+        return histogram;
     }
 
     /**
-     * @brief  Searches for a node using a ray-AABB intersection function
-     *         taking in the position of a node and the scale of the node's AABB.
-     * @param  chunk_pos The position of the chunk containing this tree relative to the
-     *                   current world root.
-     * @param  fun       Arbitrary function taking in the position and scale of the
-     *                   current Node. Returns a float scalar indicating how an orientation
-     *                   would need to be scaled to hit the AABB of the node.
-     * @return The shortest found scalar.
+     * @brief Visits every leaf whose volume intersects a box, only intersecting nodes are descended.
+     *        Recombined volumes are visited once as a whole, even if they exceed the box.
+     * @param pool Pool containing the child blocks of the tree.
+     * @param aabb Box in segment coordinates, min inclusive and max exclusive.
+     * @param fun  Receives the packed data of every intersecting leaf.
      */
-    auto Node::find_node(
-            const glm::vec3 &chunk_pos,
-            std::function<f32(const glm::vec3 &, const u32)> &fun) -> f32 {
-        if (!(this->packed_data >> 50 & MASK_6))
-            return std::numeric_limits<f32>::max();
-
-        const auto scale = 1 << ((this->packed_data >> SHIFT_HIGH) & MASK_3);
-        const auto position = chunk_pos + glm::vec3 {
-                (this->packed_data >> 45) & MASK_5,
-                (this->packed_data >> 40) & MASK_5,
-                (this->packed_data >> 35) & MASK_5
+    auto Node::for_each_in_box(
+            const NodePool &pool,
+            const util::aabb::AABB<i32> &aabb,
+            const std::function<void(u64)> &fun) const
+            -> void {
+
+        // node default init without any content
+        if (!this->packed_data)
+            return;
+
+        const u32 high = this->packed_data >> SHIFT_HIGH;
+        const i32 exponent = high & MASK_3;
+
+        // leaves are addressed by their minimum corner, every other node by its center
+        const i32 half = exponent ? (1 << (exponent - 1)) : 0;
+        const i32 edge = 1 << exponent;
+
+        const i32 min[3] = {
+                static_cast<i32>((high >> 0xD) & MASK_5) - half,
+                static_cast<i32>((high >> 0x8) & MASK_5) - half,
+                static_cast<i32>((high >> 0x3) & MASK_5) - half
         };
 
-        auto ray_scale = fun(position, scale);
+        for (u8 i = 0; i < 3; ++i)
+            if (min[i] >= aabb.max[i] || min[i] + edge <= aabb.min[i])
+                return;
+
         auto segments = this->packed_data >> 56;
+        if (!segments) {
+            fun(this->packed_data);
+            return;
+        }
 
-        if (segments) {
-            ray_scale = std::numeric_limits<f32>::max();
-            for (auto i = 0; i < 8; ++i)
-                if (segments & (1 << i)) {
-                    auto ret = this->nodes->operator[](i).find_node(chunk_pos, fun);
-                    ray_scale = ret < ray_scale ? ret : ray_scale;
-                }
+        for (u8 i = 0; i < 8; ++i)
+            if (segments & (1 << i))
+                pool[this->nodes][i].for_each_in_box(pool, aabb, fun);
+    }
+
+    /**
+     * @brief  Hands out a block of 8 default initialized children.
+     *         Released blocks are reused before the pool grows.
+     * @return Index of the block inside the pool.
+     */
+    auto NodePool::allocate() -> u32 {
+        if (!this->free_blocks.empty()) {
+            const auto index = this->free_blocks.back();
+            this->free_blocks.pop_back();
+
+            this->blocks[index] = Block {};
+            return index;
+        }
+
+        ASSERT_EQ(this->blocks.size() < UINT32_MAX);
+        this->blocks.emplace_back();
+        return static_cast<u32>(this->blocks.size() - 1);
+    }
+
+    /**
+     * @brief Marks a block as unused. Its children must not be referenced anymore.
+     * @param index Index of the block inside the pool.
+     */
+    auto NodePool::release(u32 index) -> void {
+        ASSERT_EQ(index < this->blocks.size());
+        this->free_blocks.push_back(index);
+    }
+
+    /**
+     * @brief Relayouts all reachable blocks in breadth-first order into a tightly sized
+     *        buffer. Siblings and cousins end up next to each other which keeps
+     *        the traversal cache resident. Released blocks are dropped.
+     * @param root The root of the tree owning this pool.
+     */
+    auto NodePool::compact(Node &root) -> void {
+        std::vector<Block> compacted;
+        compacted.reserve(this->blocks.size() - this->free_blocks.size());
+
+        if (root.packed_data >> 56) {
+            compacted.push_back(std::move(this->blocks[root.nodes]));
+            root.nodes = 0;
+        }
+
+        // compacted acts as the queue of the breadth-first traversal
+        for (size_t i = 0; i < compacted.size(); ++i) {
+            for (u8 j = 0; j < 8; ++j) {
+                if (!(compacted[i][j].packed_data >> 56))
+                    continue;
+
+                const auto index = compacted[i][j].nodes;
+                compacted.push_back(std::move(this->blocks[index]));
+                compacted[i][j].nodes = static_cast<u32>(compacted.size() - 1);
+            }
         }
 
-        return ray_scale;
+        this->blocks = std::move(compacted);
+        this->free_blocks = std::vector<u32> {};
+    }
+
+    /** @brief Frees every block of the pool in one deallocation. */
+    auto NodePool::clear() -> void {
+        this->blocks = std::vector<Block> {};
+        this->free_blocks = std::vector<u32> {};
+    }
+
+    /** @brief Copies every block including the released ones, indices stay valid in the copy. */
+    auto NodePool::clone() const -> NodePool {
+        NodePool pool {};
+        pool.blocks.resize(this->blocks.size());
+        pool.free_blocks = this->free_blocks;
+
+        for (size_t i = 0; i < this->blocks.size(); ++i) {
+            for (u8 j = 0; j < 8; ++j) {
+                pool.blocks[i][j].packed_data = this->blocks[i][j].packed_data;
+                pool.blocks[i][j].nodes = this->blocks[i][j].nodes;
+            }
+        }
+
+        return pool;
+    }
+
+    /** @brief Grows the storage once ahead of a known amount of allocations. */
+    auto NodePool::reserve(size_t count) -> void {
+        this->blocks.reserve(count);
+    }
+
+    /**
+     * @brief Replaces every block with blocks copied from raw bytes in the layout of node::Node.
+     * @param data  The first byte of the blocks.
+     * @param count Amount of blocks.
+     */
+    auto NodePool::assign(const u8 *data, size_t count) -> void {
+        this->blocks = std::vector<Block>(count);
+        this->free_blocks = std::vector<u32> {};
+
+        if (count)
+            std::memcpy(this->blocks.data(), data, count * sizeof(Block));
+    }
+
+    /** @brief Amount of blocks currently in use. */
+    auto NodePool::size() const -> size_t {
+        return this->blocks.size() - this->free_blocks.size();
     }
 }
\ No newline at end of file
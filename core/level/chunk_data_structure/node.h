@@ -13,22 +13,47 @@
 #include <vector>
 #include <stack>
 #include <functional>
+#include <bit>
+#include <span>
+#include <cstddef>
 
 #include "../../../util/defines.h"
 #include "glad/glad.h"
 #include "../../../util/culling.h"
 #include "../../../util/camera.h"
+#include "../../../util/aabb.h"
 
 namespace core::state {
     struct State;
 }
 
 namespace core::level::node {
-    struct Args {
-        const glm::ivec3 &_point;
-        const util::camera::Camera &_camera;
-        const VERTEX *_voxelVec;
-        u64 &actual_size;
+    class NodePool;
+
+    /** @brief Visible faces per face index, all visible faces and leaves below a node */
+    struct Histogram {
+        std::array<u32, 6> faces {};
+        u32 visible { 0 };
+        u32 leaves  { 0 };
+
+        inline auto add(u64 packed_data) -> void {
+            const u8 mask = (packed_data >> 50) & 0x3F;
+
+            for (u8 i = 0; i < 6; ++i)
+                this->faces[i] += (mask >> i) & 0x1;
+
+            this->visible += std::popcount(mask);
+            ++this->leaves;
+        }
+
+        inline auto operator+=(const Histogram &other) -> Histogram & {
+            for (u8 i = 0; i < 6; ++i)
+                this->faces[i] += other.faces[i];
+
+            this->visible += other.visible;
+            this->leaves  += other.leaves;
+            return *this;
+        }
     };
 
     struct Node {
@@ -41,18 +66,23 @@ namespace core::level::node {
         Node(const Node &) =delete;
         auto operator=(const Node &) =delete;
 
-        auto cull(Args &, util::culling::CollisionType type) const -> void;
-        auto update_face_mask(u16) -> u8;
-        auto recombine() -> void;
-        auto update_chunk_mask(u16) -> void;
-        auto count_mask(u64) -> size_t;
-        auto find_node(
-                const glm::vec3 &,
-                std::function<f32(const glm::vec3 &, const u32)> &) -> f32;
+        auto update_face_mask(NodePool &) -> u8;
+        auto recombine(NodePool &) -> Histogram;
+        auto resolve_faces(NodePool &, const std::function<u64(u64)> &) -> u8;
+        auto stream(const NodePool &, std::array<std::vector<u64>, 6> &, u8) const -> void;
+        auto histogram(const NodePool &) const -> Histogram;
+        auto for_each_in_box(
+                const NodePool &,
+                const util::aabb::AABB<i32> &,
+                const std::function<void(u64)> &) const
+                -> void;
 
-        std::unique_ptr<std::array<Node, 8>> nodes {};
         u64 packed_data { 0 };
 
+        // index of the child block inside the NodePool of the owning tree
+        // only valid if the segments of packed_data are set
+        u32 nodes { 0 };
+
         // segments: 8 | faces: 6 | curX: 5 | curY: 5 | curZ: 5 | scale: 3 (exactly 32)
         // chunkIndex2D: 12 | chunkSegmentOffsetY: 4 | unused: 8 | voxelID: 8 (exactly 32)
 
@@ -64,10 +94,57 @@ namespace core::level::node {
 
     };
 
-    static_assert(sizeof(Node) == 2 * sizeof(Node *));
+    static_assert(sizeof(Node) == 2 * sizeof(u64));
+    static_assert(offsetof(Node, nodes) == sizeof(u64), "serialized nodes are copied as is");
+
+    /**
+     * @brief Contiguous per-tree storage of child blocks.
+     *        Every interior node references its 8 children through a 32 bit index
+     *        into this pool instead of owning a separate heap allocation.
+     *        Addresses of nodes are only stable until the next allocation inside the pool.
+     */
+    class NodePool {
+    public:
+        using Block = std::array<Node, 8>;
+
+        NodePool() =default;
+        ~NodePool() =default;
+
+        NodePool(NodePool &&) noexcept =default;
+        auto operator=(NodePool &&) noexcept -> NodePool & =default;
+
+        NodePool(const NodePool &) =delete;
+        auto operator=(const NodePool &) =delete;
+
+        auto allocate() -> u32;
+        auto release(u32) -> void;
+        auto compact(Node &) -> void;
+        auto clear() -> void;
+        auto clone() const -> NodePool;
+        auto reserve(size_t) -> void;
+        auto assign(const u8 *, size_t) -> void;
+        auto size() const -> size_t;
+
+        /** @brief Every block of the pool, released ones included */
+        inline auto data() const -> std::span<const Block> {
+            return this->blocks;
+        }
+
+        inline auto operator[](u32 index) -> Block & {
+            return this->blocks[index];
+        }
+
+        inline auto operator[](u32 index) const -> const Block & {
+            return this->blocks[index];
+        }
+
+    private:
+        std::vector<Block> blocks;
+        std::vector<u32> free_blocks;
+    };
 
-    inline auto insert_node(u64, u32, Node *) -> Node *;
-    inline auto find_node(u32, Node *) -> Node *;
+    inline auto insert_node(u64, u32, Node *, NodePool &) -> Node *;
+    inline auto find_node(u32, Node *, const NodePool &) -> Node *;
 }
 
 #endif //OPENGL_3D_ENGINE_NODE_H
@@ -13,6 +13,8 @@
 #include <vector>
 #include <stack>
 #include <functional>
+#include <bit>
+#include <span>
 
 #ifdef __AVX2__
 #include <immintrin.h>
@@ -20,6 +22,7 @@
 #endif
 
 #include "node.h"
+#include "node_kernels.h"
 
 #include "../util/assert.h"
 #include "../util/defines.h"
@@ -68,43 +71,9 @@ namespace core::level::node_inline {
      */
     inline static
     auto select_child(u32 packed_voxel, u32 packed_data_high) -> u8 {
-#ifdef __AVX512VL__
-        const __m128i _mask = _mm_set_epi32(0x0, x_and, y_and, z_and);
-
-        __m128i _pv = _mm_set1_epi32(packed_voxel);
-        __m128i _pd = _mm_set1_epi32(packed_data_high);
-
-        _pv = _mm_and_si128(_pv, _mask);
-        _pd = _mm_and_si128(_pd, _mask);
-
-        // (a >= b) direct computable and storable in u8 mask
-        return _mm_cmpge_epi32_mask(_pv, _pd);
-
-#elif __AVX2__
-        const __m256i _and = _mm256_set1_epi32(0x1);
-        const __m256i _mask = _mm256_set_epi32(0x0, 0x0, 0x0, 0x0, 0x0, x_and, y_and, z_and);
-
-        __m256i _pv = _mm256_set1_epi32(packed_voxel);
-        __m256i _pd = _mm256_set1_epi32(packed_data_high);
-
-        _pv = _mm256_and_si256(_pv, _mask);
-        _pd = _mm256_and_si256(_pd, _mask);
-
-        // (a >= b) is equal to !(b > a)
-        _pd = _mm256_cmpgt_epi32(_pd, _pv);
-
-        // !(b > a)
-        _pd = _mm256_xor_si256(_pd, _and);
-        _pd = _mm256_and_si256(_pd, _and);
-
-        return (_mm256_extract_epi32(_pd, 2) << 0x2) |
-               (_mm256_extract_epi32(_pd, 1) << 0x1) |
-               (_mm256_extract_epi32(_pd, 0));
-#else
-        return (((packed_voxel & x_and) >= (packed_data_high & x_and)) << 0x2) |
-               (((packed_voxel & y_and) >= (packed_data_high & y_and)) << 0x1) |
-                ((packed_voxel & z_and) >= (packed_data_high & z_and));
-#endif
+        return ((((packed_voxel >> 0xD) & MASK_5) >= ((packed_data_high >> 0xD) & MASK_5)) << 0x2) |
+               ((((packed_voxel >> 0x8) & MASK_5) >= ((packed_data_high >> 0x8) & MASK_5)) << 0x1) |
+                (((packed_voxel >> 0x3) & MASK_5) >= ((packed_data_high >> 0x3) & MASK_5));
     }
 
     /**
@@ -148,10 +117,14 @@ namespace core::level::node_inline {
      * @brief  Searches for a specific voxel via its position
      * @param  position The voxel position compressed in a u16
      * @param  current  A pointer referring to the current node
+     * @param  pool     The pool containing the child blocks of the tree
      * @return A std::optional containing either the voxel or none
      */
     inline static
-    auto find_node(u32 packed_data_high32, node::Node *current) -> node::Node * {
+    auto find_node(
+            u32 packed_data_high32,
+            node::Node *current,
+            const node::NodePool &pool) -> node::Node * {
         const auto position_vec = glm::vec3 {
                 (packed_data_high32 >> 0xD) & MASK_5,
                 (packed_data_high32 >> 0x8) & MASK_5,
@@ -198,7 +171,8 @@ namespace core::level::node_inline {
             if (!((current->packed_data >> 0x38) & (0x1 << index)))
                 return nullptr;
 
-            current = &(current->nodes->operator[](index));
+            // the pool is owned by the tree and only read here
+            current = const_cast<node::Node *>(&pool[current->nodes][index]);
             ASSERT_EQ(current);
         }
     }
@@ -208,16 +182,27 @@ namespace core::level::node_inline {
      *
      * Calculates the position of the voxel inside the tree via using the u32 higher half of
      * the last node's (or root's) packed_data packed data.
-     * The high 16 bit of the lower 32 bit of packed_data will be set
-     * with the packed_voxel high 16 bit of the lower 32 bit to contain the chunk information.
+     * The high 16 bit of the lower 32 bit of packed_data stay 0, the placement of the chunk
+     * is not stored inside the tree.
      * The lowest 16 bit of packed_data will be set to 0 unless the node becomes a voxel.
      *
      * @param  packed_voxel The voxel compressed in a u64
      * @param  data         The current bounding box of the last node (or root of the tree)
+     * @param  current      The root of the tree
+     * @param  pool         The pool containing the child blocks of the tree
      * @return The address of inserted Voxel
      */
     inline static
-    auto insert_node(u64 packed_voxel, u32 data, node::Node *current) -> node::Node * {
+    auto insert_node(
+            u64 packed_voxel,
+            u32 data,
+            node::Node *current,
+            node::NodePool &pool) -> node::Node * {
+
+        // location of current inside the pool, the root lives outside of it
+        u32 current_block = UINT32_MAX;
+        u8  current_index = 0;
+
         for(;;) {
             ASSERT_EQ(current);
             if ((0x1 << (data & MASK_3)) == BASE_SIZE) {
@@ -246,7 +231,12 @@ namespace core::level::node_inline {
                     // the bitmask before even the construction happened
 
                     // initializes the 8 new children with the default initializer of Node
-                    current->nodes = std::make_unique<std::array<node::Node, 8>>();
+                    // allocating may move the pool, thus current is re-derived from its index
+                    const u32 block = pool.allocate();
+                    current = current_block == UINT32_MAX
+                              ? current
+                              : &pool[current_block][current_index];
+                    current->nodes = block;
 
                     // initializing the current node's packed data field with
                     // segments, faces, position and high 16 bit of the packed_voxel
@@ -263,107 +253,599 @@ namespace core::level::node_inline {
                             (static_cast<u64>(segment) << 0x38) |
                             (static_cast<u64>(MASK_6) << 0x32);
 
-                ASSERT_EQ(current->nodes.get());
                 data = build_AABB(index, data);
-                current = &(current->nodes->operator[](index));
+                current_block = current->nodes;
+                current_index = index;
+                current = &pool[current_block][current_index];
             }
         }
     }
 
     /**
      * @brief  Checks if all subareas of the current volume can be combined to the current volume.
+     * @tparam K    Kernels of the executing cpu, see node_kernels::dispatch.
      * @param  node Node ptr to the current node whose children we observe.
      * @return Boolean indicating if children are combinable
      *         to volume of the size of the current node.
      */
-    template <typename ...Args>
-    requires std::conjunction_v<std::is_integral<Args> ...>
+    template <const node_kernels::Kernels &K>
     inline static
-    auto check_combinable(node::Node *node) -> bool {
+    auto check_combinable(node::Node *node, const node::NodePool &pool) -> bool {
 
         // all children must be in use
         if ((node->packed_data >> 0x38) ^ 0xFF)
             return false;
 
-#ifdef __AVX512VL__
-        __m256i _pd = _mm256_set_epi32(
-                node->nodes->operator[](0).packed_data,
-                node->nodes->operator[](1).packed_data,
-                node->nodes->operator[](2).packed_data,
-                node->nodes->operator[](3).packed_data,
-                node->nodes->operator[](4).packed_data,
-                node->nodes->operator[](5).packed_data,
-                node->nodes->operator[](6).packed_data,
-                node->nodes->operator[](7).packed_data);
-
-        __m256i _leaves = _mm256_srli_epi32(_pd, 0x38);
-        if (_mm256_cmpge_epi32_mask(_leaves, _mm256_set1_epi32(0x0)))
-            return false;
+        return K.check_combinable(pool[node->nodes]);
+    }
 
-        _leaves = _mm256_srli_epi32(_pd, SHIFT_HIGH);
-        _leaves = _mm256_and_si256(_leaves, _mm256_set1_epi32(MASK_3));
-        if (_mm256_cmpneq_epi32_mask(
-                _leaves,
-                _mm256_set1_epi32(_mm256_extract_epi32(_leaves, 0)))) {
-            return false;
+    /**
+     * @brief  Combines faces of all children to a combined face mask.
+     * @tparam K    Kernels of the executing cpu, see node_kernels::dispatch.
+     * @param  node Node ptr to the current node whose children we observe.
+     * @return Non-shifted, combined face mask.
+     */
+    template <const node_kernels::Kernels &K>
+    inline static
+    auto combine_faces(node::Node *node, const node::NodePool &pool) -> u64 {
+        return K.combine_faces(pool[node->nodes]);
+    }
+
+    /**
+     * @brief  Checks if a position lies inside the cubic volume of a node.
+     * @param  packed_data_high32 The high 32 bit of the node containing position and scale.
+     * @param  packed_voxel       The high 32 bit of the voxel containing the position.
+     * @return Boolean indicating if the position is enclosed by the volume.
+     */
+    inline static
+    auto contains(u32 packed_data_high32, u32 packed_voxel) -> bool {
+        const i32 exponent = packed_data_high32 & MASK_3;
+
+        // leaves are addressed by their minimum corner, every other node by its center
+        const i32 min = exponent ? (1 << (exponent - 1)) : 0;
+        const i32 max = exponent ? (1 << (exponent - 1)) : 1;
+
+        for (const u8 shift : { 0xD, 0x8, 0x3 }) {
+            const i32 center = (packed_data_high32 >> shift) & MASK_5;
+            const i32 point  = (packed_voxel >> shift) & MASK_5;
+
+            if (point < center - min || point >= center + max)
+                return false;
         }
 
-        _leaves = _mm256_and_si256(_pd, _mm256_set1_epi32(MASK_VOXEL_ID));
-        if (_mm256_cmpneq_epi32_mask(
-                _leaves,
-                _mm256_set1_epi32(_mm256_extract_epi32(_leaves, 0)))) {
-            return false;
+        return true;
+    }
+
+    /**
+     * @brief  Face mask of the outer faces of the parent volume a child is touching.
+     * @param  child_mask The index of the child.
+     * @return Non-shifted face mask.
+     */
+    inline static
+    auto boundary_faces(u8 child_mask) -> u64 {
+        return ((child_mask & 0x4) ? RIGHT_BIT : LEFT_BIT) |
+               ((child_mask & 0x2) ? TOP_BIT : BOTTOM_BIT) |
+               ((child_mask & 0x1) ? FRONT_BIT : BACK_BIT);
+    }
+
+    /**
+     * @brief  Picks the voxelID an inner node is drawn with once it is rendered as a single cube.
+     *         The upper children (y set) form the surface seen from afar, the most frequent
+     *         voxelID among them wins. The lower children are only consulted if no upper one exists.
+     * @param  children Child block of the inner node, inner children carry their own representative.
+     * @param  segments Segments of the inner node.
+     * @return The voxelID of the inner node.
+     */
+    inline static
+    auto representative(const node::NodePool::Block &children, u8 segments) -> u64 {
+        static constexpr const u8 upper = 0xCC;
+
+        const u8 candidates = (segments & upper) ? (segments & upper) : segments;
+
+        u64 voxel_ID = 0;
+        u8  best     = 0;
+
+        for (u8 i = 0; i < 8; ++i) {
+            if (!(candidates & (1 << i)))
+                continue;
+
+            const u64 id = children[i].packed_data & MASK_VOXEL_ID;
+
+            u8 count = 0;
+            for (u8 j = i; j < 8; ++j)
+                count += (candidates & (1 << j)) && (children[j].packed_data & MASK_VOXEL_ID) == id;
+
+            if (count > best) {
+                best     = count;
+                voxel_ID = id;
+            }
+
+            // the remaining candidates can not outnumber the current voxelID anymore
+            if (best >= std::popcount(static_cast<u8>(candidates >> (i + 1))))
+                break;
         }
-#else
-        for (const auto &child : *node->nodes) {
-            if (child.packed_data >> 0x38)
-                return false;
+
+        return voxel_ID;
+    }
+
+    /**
+     * @brief  Interleaves the position of a voxel into its morton code.
+     *         Every 3 bit group is ordered like the child index of select_child (x, y, z).
+     * @param  packed_data_high32 The high 32 bit of the voxel containing the position.
+     * @return The 15 bit morton code of the position.
+     */
+    inline static
+    auto morton(u32 packed_data_high32) -> u16 {
+
+        // spreads the 5 bit of a coordinate to every third bit
+        auto spread = [](u32 v) -> u32 {
+            v &= MASK_5;
+            v = (v | (v << 0x8)) & 0x100F;
+            v = (v | (v << 0x4)) & 0x10C3;
+            v = (v | (v << 0x2)) & 0x1249;
+            return v;
+        };
+
+        return (spread(packed_data_high32 >> 0xD) << 0x2) |
+               (spread(packed_data_high32 >> 0x8) << 0x1) |
+                spread(packed_data_high32 >> 0x3);
+    }
+
+    /**
+     * @brief  Builds a tree bottom-up in a single pass over voxels sorted by their morton code.
+     *
+     * Siblings are consecutive in morton order, thus every level only holds the group of 8
+     * slots currently being filled. As soon as a voxel of another group arrives the pending
+     * group gets closed: a single child replaces its parent, 8 uniform leaves become one
+     * recombined leaf and everything else becomes an inner node with a freshly allocated block.
+     * The result equals inserting every voxel and recombining afterwards.
+     *
+     * @param  voxels Packed voxels in ascending morton order, their faces are taken as given.
+     * @param  root   The root of the tree, overwritten unless voxels is empty.
+     * @param  pool   The pool receiving the child blocks.
+     */
+    inline static
+    auto build_nodes(std::span<const u64> voxels, node::Node *root, node::NodePool &pool) -> void {
+        struct Pending {
+            node::NodePool::Block children {};
+            u32 anchor   { 0 };
+            u16 key      { 0 };
+            u8  segments { 0 };
+        };
+
+        // pending sibling groups of the exponents 0 to 4, closing level 4 yields the root
+        std::array<Pending, 5> levels {};
+
+        auto close = [&](u8 level) -> node::Node {
+            auto &pending = levels[level];
+            const u8 segments = pending.segments;
+            const u8 first = std::countr_zero(segments);
+
+            node::Node parent {};
+            if (std::has_single_bit(segments)) {
+                parent = std::move(pending.children[first]);
+            }
+            else {
+                const u64 voxel_ID = pending.children[first].packed_data & MASK_VOXEL_ID;
+
+                u64 faces = 0;
+                bool uniform = segments == 0xFF;
+
+                for (u8 i = 0; i < 8; ++i) {
+                    if (!(segments & (1 << i)))
+                        continue;
+
+                    const u64 data = pending.children[i].packed_data;
+                    faces |= data & SET_FACES;
+                    uniform &= !(data >> 0x38) &&
+                               ((data >> SHIFT_HIGH) & MASK_3) == level &&
+                               (data & MASK_VOXEL_ID) == voxel_ID;
+                }
+
+                // center of the enclosing volume with an edge length of 2^(level + 1)
+                const u32 half  = 1 << level;
+                const u32 floor = ~((half << 1) - 1) & MASK_5;
+
+                u32 high = level + 1;
+                for (const u8 shift : { 0xD, 0x8, 0x3 })
+                    high |= (((pending.anchor >> shift) & floor) + half) << shift;
+
+                const u64 data =
+                        (static_cast<u64>(high) << SHIFT_HIGH) |
+                        faces |
+                        (pending.children[first].packed_data & 0xFFFF0000);
+
+                if (uniform) {
+                    parent.packed_data = data | voxel_ID;
+                }
+                else {
+                    parent.nodes = pool.allocate();
+                    parent.packed_data = (static_cast<u64>(segments) << 0x38) | data |
+                                         representative(pending.children, segments);
+                    pool[parent.nodes] = std::move(pending.children);
+                }
+            }
+
+            pending = Pending {};
+            return parent;
+        };
+
+        auto push = [&](auto &self, u8 level, node::Node &&node, u32 anchor) -> void {
+            if (level == levels.size()) {
+                *root = std::move(node);
+                return;
+            }
+
+            auto &pending = levels[level];
+            const u16 code = morton(anchor);
+            const u16 key  = code >> (3 * (level + 1));
+
+            // the node starts a new group, its predecessors are complete
+            if (pending.segments && pending.key != key) {
+                const u32 closed = pending.anchor;
+                self(self, level + 1, close(level), closed);
+            }
+
+            const u8 index = (code >> (3 * level)) & MASK_3;
+            pending.children[index] = std::move(node);
+            pending.segments |= 1 << index;
+            pending.key       = key;
+            pending.anchor    = anchor;
+        };
+
+        for (const u64 voxel : voxels) {
+            node::Node leaf {};
+
+            // leaves carry no segments and an exponent of 0
+            leaf.packed_data = voxel & ~(static_cast<u64>(0xFF) << 0x38) & ~(exponent_and);
+            push(push, 0, std::move(leaf), voxel >> SHIFT_HIGH);
         }
 
-        const auto &first = (*node->nodes)[0];
-        for (const auto &child : *node->nodes) {
-            if (((child.packed_data >> SHIFT_HIGH) & MASK_3) !=
-                ((first.packed_data >> SHIFT_HIGH) & MASK_3)) {
-                return false;
+        for (u8 level = 0; level < levels.size(); ++level) {
+            if (levels[level].segments) {
+                const u32 anchor = levels[level].anchor;
+                push(push, level + 1, close(level), anchor);
             }
         }
+    }
 
-        for (const auto &child : *node->nodes) {
-            if ((child.packed_data & MASK_VOXEL_ID) !=
-                (first.packed_data & MASK_VOXEL_ID)) {
-                return false;
+    /**
+     * @brief  Fills an aligned cube of 2^n voxels with a single node at the depth of its scale.
+     *
+     * Volumes on the way are only split if they differ from the filled voxel, nodes which
+     * skip levels (single children replacing their parent) are unfolded only if the cube
+     * lies outside of them. Everything below the cube is released. Afterwards the path is
+     * recombined bottom-up, thus filling the last gap of a volume merges it right away.
+     * All faces of the cube are set to visible.
+     *
+     * @tparam K                  Kernels of the executing cpu, see node_kernels::dispatch.
+     * @param  packed_voxel       The low 32 bit of the voxel containing the voxelID.
+     * @param  packed_data_high32 The minimum corner of the cube and its exponent n.
+     * @param  data               The bounding box of the root.
+     * @param  root               The root of the tree.
+     * @param  pool               The pool containing the child blocks of the tree.
+     * @return Boolean indicating if the tree changed.
+     */
+    template <const node_kernels::Kernels &K>
+    inline static
+    auto fill_node(
+            u32 packed_voxel,
+            u32 packed_data_high32,
+            u32 data,
+            node::Node *root,
+            node::NodePool &pool) -> bool {
+        const u8 exponent = packed_data_high32 & MASK_3;
+
+        // location of every node of the traversal inside the pool
+        // the root lives outside of it and is marked with UINT32_MAX
+        std::array<std::pair<u32, u8>, 8> path;
+        u8 depth = 0;
+
+        u32 block = UINT32_MAX;
+        u8 index = 0;
+
+        // unused child slots are indicated by the segments of their parent
+        bool present = root->packed_data;
+        data &= mask_coords;
+
+        auto at = [&](u32 b, u8 i) -> node::Node & {
+            return b == UINT32_MAX ? *root : pool[b][i];
+        };
+
+        auto release = [&pool](auto &self, const node::Node &node) -> void {
+            const u8 segments = node.packed_data >> 0x38;
+            for (u8 i = 0; i < 8; ++i)
+                if (segments & (1 << i))
+                    self(self, pool[node.nodes][i]);
+
+            if (segments)
+                pool.release(node.nodes);
+        };
+
+        for (;;) {
+            auto *current = &at(block, index);
+
+            if (present) {
+                const u32 high = (current->packed_data >> SHIFT_HIGH) & mask_coords;
+
+                // the node skips levels and does not enclose the cube
+                // an inner node at the expected level takes it as its only child
+                if ((high & MASK_3) < exponent || !contains(high, packed_data_high32)) {
+                    const u32 children = pool.allocate();
+                    current = &at(block, index);
+
+                    const u8 child = select_child(high, data);
+                    pool[children][child] = std::move(*current);
+
+                    const u64 moved = pool[children][child].packed_data;
+                    current->nodes = children;
+                    current->packed_data =
+                            (static_cast<u64>(1 << child) << 0x38) |
+                            (moved & SET_FACES) |
+                            (static_cast<u64>(data) << SHIFT_HIGH) |
+                            (moved & 0xFFFF0000);
+                }
+                else {
+                    data = high;
+                }
+            }
+
+            if ((data & MASK_3) == exponent)
+                break;
+
+            u8 segments = current->packed_data >> 0x38;
+            if (!present || !segments) {
+
+                // the cube lies inside a volume of the same voxel
+                if (present && (current->packed_data & MASK_VOXEL_ID) == (packed_voxel & MASK_VOXEL_ID))
+                    return false;
+
+                const u32 children = pool.allocate();
+                current = &at(block, index);
+
+                if (present) {
+
+                    // splitting a recombined volume into its 8 uniform children
+                    const u64 current_faces = current->packed_data & SET_FACES;
+                    for (u8 i = 0; i < 8; ++i) {
+                        pool[children][i].packed_data =
+                                ((static_cast<u64>(build_AABB(i, data)) << SHIFT_HIGH) & ~SET_FACES) |
+                                (current_faces & boundary_faces(i)) |
+                                (current->packed_data & UINT32_MAX);
+                    }
+
+                    segments = 0xFF;
+                    current->packed_data |= static_cast<u64>(segments) << 0x38;
+                }
+                else {
+                    current->packed_data =
+                            (static_cast<u64>(data) << SHIFT_HIGH) |
+                            (packed_voxel & 0xFFFF0000);
+                }
+
+                current->nodes = children;
             }
+
+            const u8 child = select_child(packed_data_high32, data);
+            current->packed_data |= static_cast<u64>(1 << child) << 0x38;
+
+            path[depth++] = { block, index };
+            present = segments & (1 << child);
+
+            block = current->nodes;
+            index = child;
+            data  = build_AABB(child, data) & mask_coords;
+        }
+
+        auto &target = at(block, index);
+        if (present)
+            release(release, target);
+
+        target.nodes = 0;
+        target.packed_data =
+                SET_FACES |
+                (static_cast<u64>(data) << SHIFT_HIGH) |
+                packed_voxel;
+
+        // recombining the path, merged parents release the children below them
+        while (depth) {
+            const auto [parent_block, parent_index] = path[--depth];
+            auto &parent = at(parent_block, parent_index);
+            const u8 segments = parent.packed_data >> 0x38;
+
+            if (check_combinable<K>(&parent, pool)) {
+                parent.packed_data &= (UINT64_MAX >> 14) & (UINT64_MAX << 9);
+                parent.packed_data |= combine_faces<K>(&parent, pool);
+                parent.packed_data |= pool[parent.nodes][0].packed_data & MASK_VOXEL_ID;
+
+                pool.release(parent.nodes);
+                parent.nodes = 0;
+                continue;
+            }
+
+            u64 parent_faces = 0;
+            for (u8 i = 0; i < 8; ++i)
+                if (segments & (1 << i))
+                    parent_faces |= pool[parent.nodes][i].packed_data & SET_FACES;
+
+            parent.packed_data = (parent.packed_data & ~SET_FACES & ~static_cast<u64>(MASK_VOXEL_ID)) |
+                                 parent_faces |
+                                 representative(pool[parent.nodes], segments);
         }
 
         return true;
-#endif
     }
 
     /**
-     * @brief  Combines faces of all children to a combined face mask.
-     * @param  node Node ptr to the current node whose children we observe.
-     * @return Non-shifted, combined face mask.
+     * @brief  Removes a specific voxel via its position.
+     *
+     * Recombined volumes enclosing the voxel are split into 8 uniform children per level
+     * until the voxel is reached. Inner faces of the split volume were never visible
+     * and stay hidden. Emptied nodes are released and the face masks along the
+     * touched path are rebuilt, the rest of the tree is left untouched.
+     *
+     * @param  packed_data_high32 The high 32 bit of the voxel containing the position.
+     * @param  root               The root of the tree.
+     * @param  pool               The pool containing the child blocks of the tree.
+     * @param  faces              Incremented by the change of visible faces.
+     * @return Boolean indicating if a voxel got removed.
      */
     inline static
-    auto combine_faces(node::Node *node) -> u64 {
+    auto remove_node(
+            u32 packed_data_high32,
+            node::Node *root,
+            node::NodePool &pool,
+            i32 &faces) -> bool {
+        if (!root->packed_data)
+            return false;
+
+        // location of every node of the traversal inside the pool
+        // the root lives outside of it and is marked with UINT32_MAX
+        std::array<std::pair<u32, u8>, 8> path;
+        u8 depth = 0;
 
-        // mask to extract the faces of each node
-        // packed node data in 64 bit representation assumed here
-        static constexpr const u64 mask = static_cast<u64>(MASK_6) << 0x32;
+        u32 block = UINT32_MAX;
+        u8 index = 0;
 
-#ifdef __AVX512VL__
+        auto at = [&](u32 b, u8 i) -> node::Node & {
+            return b == UINT32_MAX ? *root : pool[b][i];
+        };
 
-        // experimental
-        // TODO: maybe this is also usable for check_combinable instead of this many loads
-        __m512 _low  = _mm512_load_epi64(reinterpret_cast<u64 *>(node->nodes.get()));
-        __m512 _high = _mm512_load_epi64(reinterpret_cast<u64 *>(node->nodes.get() + 4));
-#else
-        u64 sum = 0;
-        for (const auto &child : *node->nodes)
-            sum |= child.packed_data;
+        for (;;) {
+            auto *current = &at(block, index);
+            const u32 high = current->packed_data >> SHIFT_HIGH;
 
-        return sum & mask;
-#endif
+            if (!contains(high, packed_data_high32))
+                return false;
+
+            // splitting a recombined volume into its 8 uniform children
+            if (!(current->packed_data >> 0x38) && (high & MASK_3)) {
+                const u32 children = pool.allocate();
+                current = &at(block, index);
+
+                const u64 current_faces = current->packed_data & SET_FACES;
+                for (u8 i = 0; i < 8; ++i) {
+                    pool[children][i].packed_data =
+                            ((static_cast<u64>(build_AABB(i, high)) << SHIFT_HIGH) & ~SET_FACES) |
+                            (current_faces & boundary_faces(i)) |
+                            (current->packed_data & UINT32_MAX);
+                }
+
+                // every visible face is now covered by 4 faces of the children
+                faces += 3 * std::popcount(current_faces);
+
+                current->nodes = children;
+                current->packed_data =
+                        (static_cast<u64>(0xFF) << 0x38) |
+                        (current->packed_data & (UINT64_MAX >> 8) & ~static_cast<u64>(UINT16_MAX));
+            }
+
+            const u8 segments = current->packed_data >> 0x38;
+            if (!segments)
+                break;
+
+            const u8 child = select_child(packed_data_high32, high);
+            if (!(segments & (1 << child)))
+                return false;
+
+            path[depth++] = { block, index };
+            block = current->nodes;
+            index = child;
+        }
+
+        faces -= std::popcount(at(block, index).packed_data & SET_FACES);
+
+        // unlinking the voxel, parents without any children left are unlinked as well
+        while (depth) {
+            const auto [parent_block, parent_index] = path[--depth];
+            auto &parent = at(parent_block, parent_index);
+
+            pool[parent.nodes][index] = node::Node {};
+            parent.packed_data &= ~(static_cast<u64>(1 << index) << 0x38);
+
+            if (parent.packed_data >> 0x38) {
+                ++depth;
+                break;
+            }
+
+            pool.release(parent.nodes);
+            parent.nodes = 0;
+
+            block = parent_block;
+            index = parent_index;
+        }
+
+        if (!depth) {
+            root->packed_data = 0;
+            return true;
+        }
+
+        // rebuilding the face masks and representatives along the remaining path,
+        // split volumes lost their voxelID and coarse levels draw inner nodes with it
+        while (depth) {
+            const auto [parent_block, parent_index] = path[--depth];
+            auto &parent = at(parent_block, parent_index);
+            const u8 segments = parent.packed_data >> 0x38;
+
+            u64 parent_faces = 0;
+            for (u8 i = 0; i < 8; ++i)
+                if (segments & (1 << i))
+                    parent_faces |= pool[parent.nodes][i].packed_data & SET_FACES;
+
+            parent.packed_data = (parent.packed_data & ~SET_FACES & ~static_cast<u64>(MASK_VOXEL_ID)) |
+                                 parent_faces |
+                                 representative(pool[parent.nodes], segments);
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief  Sets a face of the voxel enclosing a position to visible.
+     *         The face is propagated to every node on the path to keep the
+     *         early-outs of the traversal intact.
+     * @param  packed_data_high32 The high 32 bit of the voxel containing the position.
+     * @param  face               The non-shifted face bit.
+     * @param  root               The root of the tree.
+     * @param  pool               The pool containing the child blocks of the tree.
+     * @return The enclosing leaf (or nullptr) and if the face has been hidden before.
+     */
+    inline static
+    auto reveal_face(
+            u32 packed_data_high32,
+            u64 face,
+            node::Node *root,
+            node::NodePool &pool) -> std::pair<node::Node *, bool> {
+        if (!root->packed_data)
+            return { nullptr, false };
+
+        std::array<node::Node *, 8> path;
+        u8 depth = 0;
+
+        auto *current = root;
+        for (;;) {
+            const u32 high = current->packed_data >> SHIFT_HIGH;
+            if (!contains(high, packed_data_high32))
+                return { nullptr, false };
+
+            path[depth++] = current;
+
+            const u8 segments = current->packed_data >> 0x38;
+            if (!segments)
+                break;
+
+            const u8 child = select_child(packed_data_high32, high);
+            if (!(segments & (1 << child)))
+                return { nullptr, false };
+
+            current = &pool[current->nodes][child];
+        }
+
+        const bool hidden = !(current->packed_data & face);
+        for (u8 i = 0; i < depth; ++i)
+            path[i]->packed_data |= face;
+
+        return { current, hidden };
     }
 }
 
@@ -0,0 +1,239 @@
+//
+// Created by Luis Ruisinger on 20.10.24.
+//
+
+#include "node_kernels.h"
+
+#ifdef CPU_DISPATCH
+#include <immintrin.h>
+#endif
+
+#define SHIFT_HIGH 0x20
+
+namespace core::level::node_kernels {
+
+    /** @brief Exponent and voxelID, equal for all children of a combinable node */
+    static constexpr const u64 combinable_mask = (static_cast<u64>(0x7) << SHIFT_HIGH) | 0x1FF;
+
+    /** @brief Segments of a node, set for every inner node */
+    static constexpr const u64 segments_mask = static_cast<u64>(0xFF) << 0x38;
+
+    /** @brief Faces of a node */
+    static constexpr const u64 faces_mask = static_cast<u64>(0x3F) << 0x32;
+
+    /** @brief Rows per y of chunk::Occupancy::Padded */
+    static constexpr const u32 pitch = CHUNK_SIZE + 2;
+
+    namespace scalar {
+        auto check_combinable(const node::NodePool::Block &children) -> bool {
+            const u64 first = children[0].packed_data & combinable_mask;
+
+            for (const auto &child : children) {
+                if ((child.packed_data & segments_mask) ||
+                    (child.packed_data & combinable_mask) != first) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        auto combine_faces(const node::NodePool::Block &children) -> u64 {
+            u64 sum = 0;
+            for (const auto &child : children)
+                sum |= child.packed_data;
+
+            return sum & faces_mask;
+        }
+
+        auto emit_faces(const VERTEX &mesh, u64 placement, const u64 *faces, u32 count, VERTEX *out) -> void {
+            for (u32 i = 0; i < count; ++i)
+                for (u8 j = 0; j < 4; ++j)
+                    out[i].vertices[j] = mesh.vertices[j] | placement | faces[i];
+        }
+
+        auto expose(
+                const chunk::Occupancy::Rows &occupancy,
+                const chunk::Occupancy::Padded &cullers,
+                const chunk::Occupancy::Rows &x_neg,
+                const chunk::Occupancy::Rows &x_pos,
+                std::array<chunk::Occupancy::Rows, 6> &faces)
+                -> void {
+            for (u32 y = 0; y < CHUNK_SIZE; ++y) {
+                for (u32 z = 0; z < CHUNK_SIZE; ++z) {
+                    const u32 r = y * CHUNK_SIZE + z;
+                    const u32 p = (y + 1) * pitch + z + 1;
+
+                    const u32 o = occupancy[r];
+                    const u32 c = cullers[p];
+
+                    faces[0][r] = o & ~((c << 1) | (x_neg[r] >> 31));
+                    faces[1][r] = o & ~((c >> 1) | (x_pos[r] << 31));
+                    faces[2][r] = o & ~cullers[p + pitch];
+                    faces[3][r] = o & ~cullers[p - pitch];
+                    faces[4][r] = o & ~cullers[p + 1];
+                    faces[5][r] = o & ~cullers[p - 1];
+                }
+            }
+        }
+    }
+
+#ifdef CPU_DISPATCH
+    namespace avx2 {
+
+        /**
+         * @brief Loads packed_data of all 8 children into two registers.
+         *        Nodes are 16 byte wide, packed_data occupies the even 64 bit lanes.
+         */
+        TARGET_AVX2
+        static auto load(const node::NodePool::Block &children, __m256i &low, __m256i &high) -> void {
+            const auto *base = reinterpret_cast<const __m256i *>(children.data());
+
+            low  = _mm256_unpacklo_epi64(_mm256_loadu_si256(base),     _mm256_loadu_si256(base + 1));
+            high = _mm256_unpacklo_epi64(_mm256_loadu_si256(base + 2), _mm256_loadu_si256(base + 3));
+        }
+
+        TARGET_AVX2
+        static auto load(const u32 *ptr) -> __m256i {
+            return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr));
+        }
+
+        TARGET_AVX2
+        static auto store(u32 *ptr, __m256i v) -> void {
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(ptr), v);
+        }
+
+        TARGET_AVX2
+        auto check_combinable(const node::NodePool::Block &children) -> bool {
+            __m256i _low, _high;
+            load(children, _low, _high);
+
+            // no child may have children of its own
+            const __m256i _segments = _mm256_set1_epi64x(segments_mask);
+            if (!_mm256_testz_si256(_mm256_or_si256(_low, _high), _segments))
+                return false;
+
+            const __m256i _mask  = _mm256_set1_epi64x(combinable_mask);
+            const __m256i _first = _mm256_set1_epi64x(children[0].packed_data & combinable_mask);
+
+            const __m256i _equal = _mm256_and_si256(
+                    _mm256_cmpeq_epi64(_mm256_and_si256(_low,  _mask), _first),
+                    _mm256_cmpeq_epi64(_mm256_and_si256(_high, _mask), _first));
+
+            return _mm256_movemask_epi8(_equal) == -1;
+        }
+
+        TARGET_AVX2
+        auto combine_faces(const node::NodePool::Block &children) -> u64 {
+            __m256i _low, _high;
+            load(children, _low, _high);
+
+            const __m256i _or  = _mm256_or_si256(_low, _high);
+            const __m128i _sum = _mm_or_si128(_mm256_castsi256_si128(_or), _mm256_extracti128_si256(_or, 0x1));
+
+            return (static_cast<u64>(_mm_cvtsi128_si64(_sum)) |
+                    static_cast<u64>(_mm_extract_epi64(_sum, 0x1))) & faces_mask;
+        }
+
+        TARGET_AVX2
+        auto emit_faces(const VERTEX &mesh, u64 placement, const u64 *faces, u32 count, VERTEX *out) -> void {
+            const __m256i _base = _mm256_or_si256(
+                    _mm256_load_si256(reinterpret_cast<const __m256i *>(&mesh)),
+                    _mm256_set1_epi64x(placement));
+
+            for (u32 i = 0; i < count; ++i)
+                _mm256_store_si256(
+                        reinterpret_cast<__m256i *>(&out[i]),
+                        _mm256_or_si256(_base, _mm256_set1_epi64x(faces[i])));
+        }
+
+        TARGET_AVX2
+        auto expose(
+                const chunk::Occupancy::Rows &occupancy,
+                const chunk::Occupancy::Padded &cullers,
+                const chunk::Occupancy::Rows &x_neg,
+                const chunk::Occupancy::Rows &x_pos,
+                std::array<chunk::Occupancy::Rows, 6> &faces)
+                -> void {
+            for (u32 y = 0; y < CHUNK_SIZE; ++y) {
+
+                // 8 rows of consecutive z per iteration
+                for (u32 z = 0; z < CHUNK_SIZE; z += 8) {
+                    const u32 r = y * CHUNK_SIZE + z;
+                    const u32 p = (y + 1) * pitch + z + 1;
+
+                    const __m256i _o = load(&occupancy[r]);
+                    const __m256i _c = load(&cullers[p]);
+
+                    const __m256i _left  = _mm256_or_si256(
+                            _mm256_slli_epi32(_c, 1), _mm256_srli_epi32(load(&x_neg[r]), 31));
+                    const __m256i _right = _mm256_or_si256(
+                            _mm256_srli_epi32(_c, 1), _mm256_slli_epi32(load(&x_pos[r]), 31));
+
+                    // ~culler & occupancy
+                    store(&faces[0][r], _mm256_andnot_si256(_left, _o));
+                    store(&faces[1][r], _mm256_andnot_si256(_right, _o));
+                    store(&faces[2][r], _mm256_andnot_si256(load(&cullers[p + pitch]), _o));
+                    store(&faces[3][r], _mm256_andnot_si256(load(&cullers[p - pitch]), _o));
+                    store(&faces[4][r], _mm256_andnot_si256(load(&cullers[p + 1]), _o));
+                    store(&faces[5][r], _mm256_andnot_si256(load(&cullers[p - 1]), _o));
+                }
+            }
+        }
+    }
+
+    namespace avx512 {
+
+        /** @brief Loads packed_data of all 8 children into a single register */
+        TARGET_AVX512
+        static auto load(const node::NodePool::Block &children) -> __m512i {
+            const auto *base = reinterpret_cast<const i64 *>(children.data());
+
+            return _mm512_permutex2var_epi64(
+                    _mm512_loadu_si512(base),
+                    _mm512_setr_epi64(0, 2, 4, 6, 8, 10, 12, 14),
+                    _mm512_loadu_si512(base + 8));
+        }
+
+        TARGET_AVX512
+        auto check_combinable(const node::NodePool::Block &children) -> bool {
+            const __m512i _pd = load(children);
+
+            if (_mm512_test_epi64_mask(_pd, _mm512_set1_epi64(segments_mask)))
+                return false;
+
+            const __m512i _masked = _mm512_and_si512(_pd, _mm512_set1_epi64(combinable_mask));
+            const __m512i _first  = _mm512_set1_epi64(children[0].packed_data & combinable_mask);
+
+            return !_mm512_cmpneq_epi64_mask(_masked, _first);
+        }
+
+        TARGET_AVX512
+        auto combine_faces(const node::NodePool::Block &children) -> u64 {
+            const __m512i _pd = load(children);
+
+            // the unmasked extract and the cast leave their passthrough undefined which gcc warns about
+            const __m256i _or  = _mm256_or_si256(
+                    _mm512_maskz_extracti64x4_epi64(0xFF, _pd, 0x0),
+                    _mm512_maskz_extracti64x4_epi64(0xFF, _pd, 0x1));
+            const __m128i _sum = _mm_or_si128(_mm256_castsi256_si128(_or), _mm256_extracti128_si256(_or, 0x1));
+
+            return (static_cast<u64>(_mm_cvtsi128_si64(_sum)) |
+                    static_cast<u64>(_mm_extract_epi64(_sum, 0x1))) & faces_mask;
+        }
+    }
+#endif
+
+    auto select(util::cpu::Isa isa) -> const Kernels & {
+#ifdef CPU_DISPATCH
+        switch (isa) {
+            case util::cpu::AVX512: return avx512_kernels;
+            case util::cpu::AVX2:   return avx2_kernels;
+            default:                break;
+        }
+#endif
+        return scalar_kernels;
+    }
+
+    const Kernels &kernels = select(util::cpu::detect());
+}
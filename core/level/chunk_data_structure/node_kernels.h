@@ -0,0 +1,112 @@
+//
+// Created by Luis Ruisinger on 20.10.24.
+//
+
+#ifndef OPENGL_3D_ENGINE_NODE_KERNELS_H
+#define OPENGL_3D_ENGINE_NODE_KERNELS_H
+
+#include "node.h"
+#include "../chunk/occupancy.h"
+
+#include "../../../util/defines.h"
+#include "../../../util/cpu.h"
+
+namespace core::level::node_kernels {
+
+    /**
+     * @brief Per instruction set variants of the hot node kernels.
+     *        Every variant is compiled into the binary, the executing cpu decides which one is used.
+     */
+    struct Kernels {
+        util::cpu::Isa isa;
+
+        /** @brief All 8 children are leaves of equal exponent and voxelID */
+        bool (*check_combinable)(const node::NodePool::Block &);
+
+        /** @brief Union of the shifted faces of all 8 children */
+        u64 (*combine_faces)(const node::NodePool::Block &);
+
+        /** @brief Writes one quad per face, the vertices of the mesh combined with the placement and the face */
+        void (*emit_faces)(const VERTEX &, u64, const u64 *, u32, VERTEX *);
+
+        /** @brief Exposed faces of every occupied voxel of a segment, see chunk::Occupancy::expose */
+        void (*expose)(
+                const chunk::Occupancy::Rows &,
+                const chunk::Occupancy::Padded &,
+                const chunk::Occupancy::Rows &,
+                const chunk::Occupancy::Rows &,
+                std::array<chunk::Occupancy::Rows, 6> &);
+    };
+
+    namespace scalar {
+        auto check_combinable(const node::NodePool::Block &) -> bool;
+        auto combine_faces(const node::NodePool::Block &) -> u64;
+        auto emit_faces(const VERTEX &, u64, const u64 *, u32, VERTEX *) -> void;
+        auto expose(
+                const chunk::Occupancy::Rows &,
+                const chunk::Occupancy::Padded &,
+                const chunk::Occupancy::Rows &,
+                const chunk::Occupancy::Rows &,
+                std::array<chunk::Occupancy::Rows, 6> &)
+                -> void;
+    }
+
+    inline constexpr const Kernels scalar_kernels = {
+            util::cpu::SCALAR, scalar::check_combinable, scalar::combine_faces, scalar::emit_faces, scalar::expose
+    };
+
+#ifdef CPU_DISPATCH
+    namespace avx2 {
+        auto check_combinable(const node::NodePool::Block &) -> bool;
+        auto combine_faces(const node::NodePool::Block &) -> u64;
+        auto emit_faces(const VERTEX &, u64, const u64 *, u32, VERTEX *) -> void;
+        auto expose(
+                const chunk::Occupancy::Rows &,
+                const chunk::Occupancy::Padded &,
+                const chunk::Occupancy::Rows &,
+                const chunk::Occupancy::Rows &,
+                std::array<chunk::Occupancy::Rows, 6> &)
+                -> void;
+    }
+
+    namespace avx512 {
+        auto check_combinable(const node::NodePool::Block &) -> bool;
+        auto combine_faces(const node::NodePool::Block &) -> u64;
+    }
+
+    inline constexpr const Kernels avx2_kernels = {
+            util::cpu::AVX2, avx2::check_combinable, avx2::combine_faces, avx2::emit_faces, avx2::expose
+    };
+
+    // a quad and 8 rows fill a 256 bit register, the AVX2 emission and sweep are used as is
+    inline constexpr const Kernels avx512_kernels = {
+            util::cpu::AVX512, avx512::check_combinable, avx512::combine_faces, avx2::emit_faces, avx2::expose
+    };
+#endif
+
+    auto select(util::cpu::Isa) -> const Kernels &;
+
+    /** @brief Kernels of the best instruction set of the executing cpu, chosen once at startup */
+    extern const Kernels &kernels;
+
+    /**
+     * @brief  Runs an operation instantiated for the kernels of the executing cpu.
+     *         The table is known inside the operation, every kernel is called directly
+     *         instead of through a function pointer per node.
+     * @param  fun Generic lambda taking the kernels as template parameter.
+     * @return The result of the operation.
+     */
+    template <typename F>
+    inline auto dispatch(F &&fun) -> decltype(auto) {
+#ifdef CPU_DISPATCH
+        switch (kernels.isa) {
+            case util::cpu::AVX512: return fun.template operator()<avx512_kernels>();
+            case util::cpu::AVX2:   return fun.template operator()<avx2_kernels>();
+            default:                break;
+        }
+#endif
+        return fun.template operator()<scalar_kernels>();
+    }
+}
+
+#endif //OPENGL_3D_ENGINE_NODE_KERNELS_H
@@ -4,52 +4,386 @@
 
 #include <immintrin.h>
 #include <cmath>
+#include <cstring>
 
 #include "octree.h"
 
 namespace core::level::octree {
 
+    Octree::~Octree() {
+        if (this->_shared)
+            dag::instance().release(this->_root);
+    }
+
     auto Octree::addPoint(u64 packedVoxel) -> node::Node * {
-        return node_inline::insert_node(packedVoxel, this->_packed, this->_root.get());
+        thaw();
+        return node_inline::insert_node(packedVoxel, this->_packed, &this->_root, this->_pool);
     }
 
-    auto Octree::removePoint(u16 position) -> void {}
+    /**
+     * @brief  Fills a box of the segment with a single voxelID. The box is split into the
+     *         largest aligned cubes it contains, every cube is inserted as a single node.
+     * @param  aabb     Box in segment coordinates, min inclusive and max exclusive.
+     *                  Anything outside of the segment is ignored.
+     * @param  voxel_ID The voxelID of the filled volume.
+     * @return Boolean indicating if the tree changed.
+     */
+    auto Octree::fill(const util::aabb::AABB<i32> &aabb, u16 voxel_ID) -> bool {
+        const auto min = glm::max(aabb.min, glm::ivec3 { 0 });
+        const auto max = glm::min(aabb.max, glm::ivec3 { CHUNK_SIZE });
 
-    auto Octree::cull(
-            const glm::ivec3 &position,
-            const util::camera::Camera &camera,
-            const VERTEX *voxelVec,
-            u64 &actual_size) const
-            -> void {
-        node::Args args = {
-                position, camera, voxelVec, actual_size
+        if (min.x >= max.x || min.y >= max.y || min.z >= max.z)
+            return false;
+
+        thaw();
+
+        const u32 packed_voxel = voxel_ID & MASK_VOXEL_ID;
+
+        // descends the aligned cubes of the segment, only cubes cut by the box are split
+        return node_kernels::dispatch([&]<const node_kernels::Kernels &K>() -> bool {
+            auto split = [&](auto &self, glm::ivec3 corner, u8 exponent) -> bool {
+                const auto end = corner + (1 << exponent);
+
+                bool inside = true;
+                for (u8 i = 0; i < 3; ++i) {
+                    if (corner[i] >= max[i] || end[i] <= min[i])
+                        return false;
+
+                    inside &= corner[i] >= min[i] && end[i] <= max[i];
+                }
+
+                if (inside) {
+                    const u32 packed_data_high32 =
+                            (corner.x << 0xD) | (corner.y << 0x8) | (corner.z << 0x3) | exponent;
+
+                    return node_inline::fill_node<K>(
+                            packed_voxel, packed_data_high32, this->_packed, &this->_root, this->_pool);
+                }
+
+                bool changed = false;
+                const i32 half = 1 << (exponent - 1);
+
+                for (u8 i = 0; i < 8; ++i) {
+                    const auto offset = glm::ivec3 { (i >> 2) & 0x1, (i >> 1) & 0x1, i & 0x1 } * half;
+                    changed |= self(self, corner + offset, exponent - 1);
+                }
+
+                return changed;
+            };
+
+            return split(split, glm::ivec3 { 0 }, 5);
+        });
+    }
+
+    /**
+     * @brief Replaces the content of the tree with voxels sorted by their morton code.
+     *        The tree is built recombined and compact, no further recombine is needed.
+     * @param voxels Packed voxels in ascending morton order, faces already resolved.
+     */
+    auto Octree::build_from_sorted(std::span<const u64> voxels) -> void {
+        if (this->_shared)
+            dag::instance().release(this->_root);
+
+        this->_shared = false;
+        this->_root = node::Node {};
+        this->_pool.clear();
+
+        node_inline::build_nodes(voxels, &this->_root, this->_pool);
+    }
+
+    auto Octree::removePoint(u16 position, i32 &faces) -> bool {
+        const u32 x = (position >> 10) & MASK_5;
+        const u32 y = (position >>  5) & MASK_5;
+        const u32 z =  position        & MASK_5;
+
+        thaw();
+        return node_inline::remove_node(
+                (x << 13) | (y << 8) | (z << 3) | MASK_3, &this->_root, this->_pool, faces);
+    }
+
+    auto Octree::reveal(u32 packedVoxel, u64 face) -> std::pair<node::Node *, bool> {
+        thaw();
+        return node_inline::reveal_face(packedVoxel, face, &this->_root, this->_pool);
+    }
+
+    auto Octree::find(u32 packedVoxel) -> node::Node * {
+
+        // the caller may modify the node
+        thaw();
+        return node_inline::find_node(packedVoxel, &this->_root, this->_pool);
+    }
+
+    /**
+     * @brief  Reads the leaf enclosing a position without thawing a shared tree.
+     * @param  packedVoxel The high 32 bit of the voxel containing the position.
+     * @return The packed data of the leaf, 0 if the position is empty.
+     */
+    auto Octree::lookup(u32 packedVoxel) const -> u64 {
+        auto read = [&](const node::NodePool &pool) -> u64 {
+            const auto *node = node_inline::find_node(
+                    packedVoxel, const_cast<node::Node *>(&this->_root), pool);
+            return node ? node->packed_data : 0;
         };
-        this->_root->cull(args, util::culling::INTERSECT);
+
+        if (!this->_shared)
+            return read(this->_pool);
+
+        auto &dag = dag::instance();
+        const auto lock = dag.lock();
+        return read(dag.pool());
     }
 
-    auto Octree::find(u32 packedVoxel) const -> node::Node * {
-        return node_inline::find_node(packedVoxel, _root.get());
+    auto Octree::updateFaceMask() -> u8 {
+        thaw();
+        return this->_root.update_face_mask(this->_pool);
     }
 
-    auto Octree::find(
-            const glm::vec3 &chunk_pos,
-            std::function<f32(const glm::vec3 &, const u32)> &fun) -> f32 {
-        return this->_root->find_node(chunk_pos, fun);
+    auto Octree::recombine() -> node::Histogram {
+        thaw();
+        return this->_root.recombine(this->_pool);
     }
 
-    auto Octree::updateFaceMask(u16 mask) -> u8 {
-        return this->_root->update_face_mask(mask);
+    /**
+     * @brief Relayouts the blocks that survived recombining in breadth-first order and drops
+     *        the released ones. Meant to run once a tree is complete, edits reuse released
+     *        blocks through the free list of the pool instead.
+     */
+    auto Octree::compact() -> void {
+        if (this->_shared)
+            return;
+
+        this->_pool.compact(this->_root);
     }
 
-    auto Octree::recombine() -> void {
-        this->_root->recombine();
+    auto Octree::resolve_faces(const std::function<u64(u64)> &fun) -> u8 {
+        thaw();
+        return this->_root.resolve_faces(this->_pool, fun);
     }
 
-    auto Octree::update_chunk_mask(u16 mask) -> void {
-        this->_root->update_chunk_mask(mask);
+    auto Octree::stream(std::array<std::vector<u64>, 6> &faces, u8 level) const -> void {
+        if (!this->_shared) {
+            this->_root.stream(this->_pool, faces, level);
+            return;
+        }
+
+        auto &dag = dag::instance();
+        const auto lock = dag.lock();
+        this->_root.stream(dag.pool(), faces, level);
     }
 
-    auto Octree::count_mask(u64 mask) -> size_t {
-        return this->_root->count_mask(mask);
+    auto Octree::histogram() const -> node::Histogram {
+        if (this->_shared) {
+            auto &dag = dag::instance();
+            const auto lock = dag.lock();
+            return this->_root.histogram(dag.pool());
+        }
+
+        return this->_root.histogram(this->_pool);
+    }
+
+    /**
+     * @brief  Bytes of the blocks owned by the tree, subtrees inside the shared dag are not counted.
+     * @return Size of the private pool in use.
+     */
+    auto Octree::memory() const -> size_t {
+        return this->_shared ? 0 : this->_pool.size() * sizeof(node::NodePool::Block);
+    }
+
+    /**
+     * @brief Visits every leaf intersecting a box of the segment, recombined cubes as a single hit.
+     *        The visitor must not modify the tree.
+     * @param aabb Box in segment coordinates, min inclusive and max exclusive.
+     * @param fun  Receives the packed data of every intersecting leaf.
+     */
+    auto Octree::for_each_in_box(
+            const util::aabb::AABB<i32> &aabb,
+            const std::function<void(u64)> &fun) const
+            -> void {
+        if (!this->_shared) {
+            this->_root.for_each_in_box(this->_pool, aabb, fun);
+            return;
+        }
+
+        auto &dag = dag::instance();
+        const auto lock = dag.lock();
+        this->_root.for_each_in_box(dag.pool(), aabb, fun);
+    }
+
+    /**
+     * @brief Moves the children of the root into the shared dag, identical subtrees of
+     *        other trees are reused. The private pool is freed.
+     *        Any modification copies the tree back into a private pool first.
+     */
+    auto Octree::deduplicate() -> void {
+        if (this->_shared)
+            return;
+
+        dag::instance().intern(this->_root, this->_pool);
+        this->_pool.clear();
+        this->_shared = true;
+    }
+
+    /**
+     * @brief  Copies the tree into a new private tree, the copy can be modified
+     *         while the original is still being read.
+     * @return The copied tree.
+     */
+    auto Octree::clone() const -> std::unique_ptr<Octree> {
+        auto tree = std::make_unique<Octree>();
+
+        if (this->_shared) {
+            dag::instance().expand(this->_root, tree->_root, tree->_pool);
+            return tree;
+        }
+
+        tree->_root.packed_data = this->_root.packed_data;
+        tree->_root.nodes = this->_root.nodes;
+        tree->_pool = this->_pool.clone();
+        return tree;
+    }
+
+    /**
+     * @brief Appends the tree in the layout of serialization::Header to a buffer.
+     *        The root is followed by the blocks of the pool in their order, shared trees
+     *        and pools holding released blocks are written as a compacted copy.
+     * @param out Buffer the serialized tree is appended to.
+     */
+    auto Octree::serialize(std::vector<u8> &out) const -> void {
+        if (this->_shared || this->_pool.size() != this->_pool.data().size()) {
+            auto tree = clone();
+            tree->_pool.compact(tree->_root);
+            tree->serialize(out);
+            return;
+        }
+
+        const auto blocks = this->_pool.data();
+        const serialization::Header header {
+                serialization::magic,
+                serialization::version,
+                0,
+                static_cast<u32>(1 + blocks.size() * 8),
+                static_cast<u32>(blocks.size())
+        };
+
+        size_t at = out.size();
+        out.resize(at + sizeof(header) + header.count * sizeof(node::Node));
+
+        std::memcpy(out.data() + at, &header, sizeof(header));
+        at += sizeof(header);
+
+        // padding of the nodes is written as 0 to keep the output deterministic
+        auto write = [&](const node::Node &node) -> void {
+            const u32 unused = 0;
+
+            std::memcpy(out.data() + at, &node.packed_data, sizeof(u64));
+            std::memcpy(out.data() + at + 0x8, &node.nodes, sizeof(u32));
+            std::memcpy(out.data() + at + 0xC, &unused, sizeof(u32));
+            at += sizeof(node::Node);
+        };
+
+        write(this->_root);
+        for (const auto &block : blocks)
+            for (const auto &node : block)
+                write(node);
+    }
+
+    /**
+     * @brief  Replaces the content of the tree with a serialized tree.
+     *         The blocks are copied into the pool at once, a single pass afterwards checks
+     *         that every block is reached exactly once from the root.
+     * @param  in Buffer starting with a serialization::Header.
+     * @return Nothing or the reason the data was rejected, the tree is empty in that case.
+     */
+    auto Octree::deserialize(std::span<const u8> in) -> Result<void, serialization::Error> {
+        if (this->_shared)
+            dag::instance().release(this->_root);
+
+        this->_shared = false;
+        this->_root = node::Node {};
+        this->_pool.clear();
+
+        serialization::Header header;
+        if (in.size() < sizeof(header))
+            return Err(serialization::Error::TRUNCATED);
+
+        std::memcpy(&header, in.data(), sizeof(header));
+
+        if (header.magic != serialization::magic)
+            return Err(serialization::Error::INVALID_MAGIC);
+
+        if (header.version != serialization::version)
+            return Err(serialization::Error::UNSUPPORTED_VERSION);
+
+        // a segment has at most 4681 inner nodes, one block each
+        if (header.blocks > (1 << 13) || header.count != 1 + header.blocks * 8)
+            return Err(serialization::Error::CORRUPTED);
+
+        if (in.size() - sizeof(header) < static_cast<size_t>(header.count) * sizeof(node::Node))
+            return Err(serialization::Error::TRUNCATED);
+
+        const u8 *nodes = in.data() + sizeof(header);
+
+        std::memcpy(&this->_root.packed_data, nodes, sizeof(u64));
+        std::memcpy(&this->_root.nodes, nodes + 0x8, sizeof(u32));
+        this->_pool.assign(nodes + sizeof(node::Node), header.blocks);
+
+        auto fail = [&]() -> Result<void, serialization::Error> {
+            this->_root = node::Node {};
+            this->_pool.clear();
+            return Err(serialization::Error::CORRUPTED);
+        };
+
+        if (!this->_root.packed_data)
+            return header.blocks ? fail() : Ok();
+
+        // blocks reached so far, a block reached twice would share or cycle
+        std::vector<bool> reached(header.blocks, false);
+        std::vector<u32> pending;
+        u32 count = 0;
+
+        auto reach = [&](const node::Node &node) -> bool {
+            if (!(node.packed_data >> 0x38))
+                return true;
+
+            if (node.nodes >= header.blocks || reached[node.nodes])
+                return false;
+
+            reached[node.nodes] = true;
+            pending.push_back(node.nodes);
+            ++count;
+            return true;
+        };
+
+        if (!reach(this->_root))
+            return fail();
+
+        while (!pending.empty()) {
+            const u32 block = pending.back();
+            pending.pop_back();
+
+            for (const auto &child : this->_pool[block])
+                if (!reach(child))
+                    return fail();
+        }
+
+        if (count != header.blocks)
+            return fail();
+
+        return Ok();
+    }
+
+    /** @brief Copies a shared tree back into the private pool. */
+    auto Octree::thaw() -> void {
+        if (!this->_shared)
+            return;
+
+        auto &dag = dag::instance();
+
+        node::Node root {};
+        dag.expand(this->_root, root, this->_pool);
+        dag.release(this->_root);
+
+        this->_root = std::move(root);
+        this->_shared = false;
     }
-}
\ No newline at end of file
+}
@@ -13,40 +13,54 @@
 #include <vector>
 #include <stack>
 #include <functional>
+#include <span>
 
 #include "../../../util/defines.h"
+#include "../../../util/result.h"
 #include "glad/glad.h"
 #include "node_inline.h"
 #include "node.h"
+#include "dag.h"
+#include "serialization.h"
 
 namespace core::level::octree {
 
     class Octree {
     public:
         Octree() =default;
-        ~Octree() = default;
+        ~Octree();
 
         auto addPoint(u64) -> node::Node *;
-        auto removePoint(u16) -> void;
-        auto cull(
-                const glm::ivec3 &,
-                const util::camera::Camera &,
-                const VERTEX *,
-                u64 &) const
-                -> void;
-        auto find(u32) const -> node::Node *;
-        auto find(
-                const glm::vec3 &,
-                std::function<f32(const glm::vec3 &, const u32)> &) -> f32;
-        auto updateFaceMask(u16) -> u8;
-        auto update_chunk_mask(u16) -> void;
-        auto recombine() -> void;
-        auto count_mask(u64) -> size_t;
+        auto fill(const util::aabb::AABB<i32> &, u16) -> bool;
+        auto build_from_sorted(std::span<const u64>) -> void;
+        auto removePoint(u16, i32 &) -> bool;
+        auto reveal(u32, u64) -> std::pair<node::Node *, bool>;
+        auto find(u32) -> node::Node *;
+        auto lookup(u32) const -> u64;
+        auto updateFaceMask() -> u8;
+        auto resolve_faces(const std::function<u64(u64)> &) -> u8;
+        auto stream(std::array<std::vector<u64>, 6> &, u8 = 0) const -> void;
+        auto recombine() -> node::Histogram;
+        auto compact() -> void;
+        auto histogram() const -> node::Histogram;
+        auto memory() const -> size_t;
+        auto for_each_in_box(const util::aabb::AABB<i32> &, const std::function<void(u64)> &) const -> void;
+        auto deduplicate() -> void;
+        auto clone() const -> std::unique_ptr<Octree>;
+        auto serialize(std::vector<u8> &) const -> void;
+        auto deserialize(std::span<const u8>) -> Result<void, serialization::Error>;
 
     private:
+        auto thaw() -> void;
 
         /** @brief Root of the chunk_data_structure */
-        std::unique_ptr<node::Node> _root = std::make_unique<node::Node>();
+        node::Node _root {};
+
+        /** @brief Contiguous storage of all child blocks below the root */
+        node::NodePool _pool {};
+
+        /** @brief Indicates the children of the root live inside the shared dag */
+        bool _shared { false };
 
         /** @brief Sets the base bounding volume for an chunk_data_structure */
         const u32 _packed = (0x3F << 18) | (0x10 << 13) | (0x10 << 8) | (0x10 << 3) | 5;
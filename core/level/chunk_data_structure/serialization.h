@@ -0,0 +1,45 @@
+//
+// Created by Luis Ruisinger on 02.11.24.
+//
+
+#ifndef OPENGL_3D_ENGINE_SERIALIZATION_H
+#define OPENGL_3D_ENGINE_SERIALIZATION_H
+
+#include "../../../util/defines.h"
+
+namespace core::level::serialization {
+
+    /**
+     * @brief Binary layout of a serialized tree, all values little endian.
+     *
+     * The header is followed by count nodes, the root first and the blocks of the pool
+     * afterwards, 8 nodes each. Every node takes 16 bytes, its packed data (u64), the index
+     * of its child block (u32) and 4 bytes of padding set to 0, as a node::Node in memory.
+     * Trees carry no chunk index or segment offset, a loaded tree is position independent.
+     * Loading reserves the blocks counted in the header and copies them in one go.
+     */
+    struct Header {
+        u32 magic;
+        u16 version;
+        u16 flags;
+        u32 count;
+        u32 blocks;
+    };
+
+    static_assert(sizeof(Header) == 16);
+
+    /** @brief "SVO" followed by a 0 byte, read as little endian */
+    static constexpr const u32 magic = 0x004F5653;
+
+    /** @brief Increased on every change of the layout, older versions are rejected */
+    static constexpr const u16 version = 2;
+
+    enum Error : u8 {
+        TRUNCATED,
+        INVALID_MAGIC,
+        UNSUPPORTED_VERSION,
+        CORRUPTED
+    };
+}
+
+#endif //OPENGL_3D_ENGINE_SERIALIZATION_H
@@ -2,6 +2,8 @@
 // Created by Luis Ruisinger on 14.03.24.
 //
 
+#include <algorithm>
+
 #include "voxel.h"
 #include "../../../util/log.h"
 
@@ -97,13 +99,8 @@ namespace core::level::model::voxel {
                        (face[i].texture_offset << 11);
         }
 
-#ifdef __AVX2__
-        __m256i combined = _mm256_loadu_si256(
-                reinterpret_cast<__m256i const *>(faces.data()));
-        _mm256_storeu_si256(&this->compressed_faces[face_idx], combined);
-#else
-        this->compressed_faces[face_idx] = std::move(faces);
-#endif
+        auto &vertices = this->compressed_faces[face_idx].vertices;
+        std::copy_n(faces.begin(), std::min(faces.size(), vertices.size()), vertices.begin());
     }
 
     auto CubeStructure::mesh() const  -> const Compressed & {
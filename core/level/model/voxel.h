@@ -13,11 +13,7 @@
 namespace core::level::model::voxel {
     class Voxel {
     public:
-#ifdef __AVX2__
-        using Compressed = std::array<__m256i, 6>;
-#else
-        using Compressed = std::array<std::vector<u64>, 6>;
-#endif
+        using Compressed = std::array<VERTEX, 6>;
         constexpr virtual auto mesh() const -> const Compressed & =0;
     };
 
@@ -3,35 +3,38 @@
 //
 
 #include <ranges>
+#include <algorithm>
 
 #include "platform.h"
 #include "../rendering/interface.h"
 #include "../../util/assert.h"
 #include "../../util/player.h"
 
-#define INDEX(_x, _z) \
-    ((((_x) + RENDER_RADIUS)) + (((_z) + RENDER_RADIUS) * (2 * RENDER_RADIUS)))
-
-#define POSITION(_i, _r) \
-    (glm::vec2 { (((_i) % ((_r) * 2)) - (_r)), \
-                 (((_i) / ((_r) * 2)) - (_r))})
-
 #define DISTANCE_2D(_p1, _p2) \
     (std::hypot((_p1).x - (_p2).x, (_p1).y - (_p2).y))
 
 #define LOAD_THRESHOLD(_p1, _p2) \
     (DISTANCE_2D((_p1), (_p2)) >= CHUNK_SIZE * 2)
 
+// chunk coordinates inside the region around an origin in units of chunks
+#define IN_REGION(_origin, _c) \
+    (DISTANCE_2D(glm::vec2(-0.5), glm::vec2((_c) - (_origin))) < RENDER_RADIUS)
+
+#define STAGING_KEY(_c) \
+    ((static_cast<u64>(static_cast<u32>((_c).x)) << SHIFT_HIGH) | static_cast<u32>((_c).y))
+
 namespace core::level::platform {
 
 
 
     /**
-     * @brief Update platform if needed. Load new chunks if threshold is hit.
-     * @param thread_pool Pool to offload tasks.
-     * @param camera Current active camera.
+     * @brief Streams the chunks of the region around the camera, nearest and visible ones first.
+     *        Every chunk is drawn once its own jobs finished, the region moves as soon as the
+     *        jobs inside the tick pool finished after the threshold was hit.
+     * @param state The global state.
      */
     auto Platform::tick(state::State &state) -> void {
+        const auto start = std::chrono::steady_clock::now();
         const auto &cameraPos = state.player
                 .get_camera()
                 .get_position();
@@ -41,195 +44,473 @@ namespace core::level::platform {
                 std::lround(static_cast<i32>(cameraPos.z / CHUNK_SIZE)) * CHUNK_SIZE
         };
 
-        static auto init_fun = [&](Init) -> PlatformState {
+        predict(glm::vec2 { cameraPos.x, cameraPos.z }, start);
+
+        auto init_fun = [&](Init) -> PlatformState {
             this->new_root = new_root_candidate;
-            load_chunks(state.chunk_tick_pool);
-            return Loading {};
+            shift(state.chunk_tick_pool);
+            dispatch(state, start);
+            return Streaming {};
         };
 
-        static auto idle_fun = [&](Idle) -> PlatformState {
-            if (this->queue_ready || !LOAD_THRESHOLD(this->current_root, new_root_candidate))
-                return Idle {};
+        auto streaming_fun = [&](Streaming) -> PlatformState {
+            retire();
 
-            if (!state.chunk_tick_pool.no_tasks())
-                return Idle {};
+            if (LOAD_THRESHOLD(this->current_root, new_root_candidate))
+                return Draining {};
 
-            this->new_root = new_root_candidate;
-            load_chunks(state.chunk_tick_pool);
-            return Loading {};
+            dispatch(state, start);
+            prefetch(state, start);
+            return Streaming {};
         };
 
-        static auto loading_fun = [&](Loading) -> PlatformState {
+        // running jobs follow neighbor links, the region only moves once they finished
+        auto draining_fun = [&](Draining) -> PlatformState {
             if (!state.chunk_tick_pool.no_tasks())
-                return Loading {};
+                return Draining {};
+
+            retire();
 
-            compress_chunks(state.chunk_tick_pool);
-            return Compressing {};
+            this->new_root = new_root_candidate;
+            shift(state.chunk_tick_pool);
+            dispatch(state, start);
+            return Streaming {};
         };
 
-        static auto compressing_fun = [&](Compressing) -> PlatformState  {
-            if (!state.chunk_tick_pool.no_tasks())
-                return Compressing {};
+        this->platform_state = std::visit(
+                overload { init_fun, streaming_fun, draining_fun }, this->platform_state);
+    }
 
-            swap_chunks();
-            return Swapping {};
+    /**
+     * @brief Moves the region to the new root. Runs while the tick pool is drained, the new
+     *        ring is queued for generation and chunks outside of the region are unloaded.
+     * @param thread_pool Threadpool to parallel destroy unused chunks.
+     */
+    auto Platform::shift(threading::thread_pool::Tasksystem<> &thread_pool) -> void {
+        ASSERT_EQ(this->in_flight.empty());
+
+        load_chunks();
+        swap_chunks();
+        unload_chunks(thread_pool);
+
+        this->pending.clear();
+        for (u32 i = 0; i < this->active_chunks.size(); ++i) {
+            if (!this->active_chunks[i])
+                continue;
+
+            // adopted chunks are generated already, drawn neighbors seal against them and vice versa
+            if (this->stages[i] == Stage::READY && this->active_chunks[i]->unresolved_seams())
+                this->stages[i] = Stage::UNSEALED;
+
+            const auto stage = this->stages[i];
+            if (stage == Stage::QUEUED || stage == Stage::GENERATED || stage == Stage::UNSEALED)
+                this->pending.push_back(i);
+        }
+    }
+
+    /** @brief Advances every chunk whose job finished, chunks that got drawn are sealed if needed. */
+    auto Platform::retire() -> void {
+        auto ready = [this](u32 slot) -> void {
+            const bool unsealed = this->active_chunks[slot]->unresolved_seams();
+            this->stages[slot] = unsealed ? Stage::UNSEALED : Stage::READY;
+
+            if (unsealed)
+                this->pending.push_back(slot);
         };
 
-        static auto swapping_fun = [&](Swapping) -> PlatformState  {
-            unload_chunks(state.chunk_tick_pool);
-            return Unloading {};
+        std::erase_if(this->in_flight, [&](u32 slot) -> bool {
+            auto *chunk = this->active_chunks[slot];
+
+            switch (this->stages[slot]) {
+                case Stage::GENERATING:
+                    if (!chunk->is_generated())
+                        return false;
+
+                    this->stages[slot] = Stage::GENERATED;
+                    this->pending.push_back(slot);
+                    return true;
+
+                case Stage::COMPRESSING:
+                    if (!chunk->is_initialized())
+                        return false;
+
+                    ready(slot);
+                    return true;
+
+                case Stage::SEALING:
+                    if (this->sealing[slot].load(std::memory_order_acquire))
+                        return false;
+
+                    ready(slot);
+                    return true;
+
+                default:
+                    return true;
+            }
+        });
+
+        // drawn chunks whose neighbor finished generating or edited voxels next to the seam,
+        // the chunk resolves its own faces again within a seal job
+        for (auto *chunk : this->active_chunks_vec)
+            if (this->stages[chunk->index()] == Stage::READY && chunk->unresolved_seams())
+                ready(chunk->index());
+    }
+
+    /**
+     * @brief Hands the most urgent jobs to the tick pool until it holds STREAMING_IN_FLIGHT
+     *        chunks or the budget of the tick is spent. Chunks inside the frustum come first,
+     *        otherwise the distance to the camera decides.
+     * @param state The global state.
+     * @param start Begin of the current tick.
+     */
+    auto Platform::dispatch(state::State &state, std::chrono::steady_clock::time_point start) -> void {
+        const u32 limit = std::max<u32>(STREAMING_IN_FLIGHT, 1);
+        if (this->pending.empty() || this->in_flight.size() >= limit)
+            return;
+
+        const auto &camera = state.player.get_camera();
+        const auto position = glm::vec2 { camera.get_position().x, camera.get_position().z };
+
+        thread_local std::vector<std::pair<f32, u32>> order;
+        order.clear();
+
+        for (const u32 slot : this->pending) {
+            const auto center =
+                    glm::vec2(this->active_chunks[slot]->coordinates() * CHUNK_SIZE) +
+                    static_cast<f32>(CHUNK_SIZE / 2);
+
+            const f32 distance = glm::distance(center, position);
+            order.emplace_back(
+                    camera.check_in_frustum(center, CHUNK_SIZE) ? distance : distance + STREAMING_HIDDEN_PENALTY,
+                    slot);
+        }
+
+        const size_t count = std::min<size_t>(limit - this->in_flight.size(), order.size());
+        std::partial_sort(order.begin(), order.begin() + count, order.end());
+
+        size_t launched = 0;
+        while (launched < count && std::chrono::steady_clock::now() - start < STREAMING_BUDGET)
+            launch(order[launched++].second, state.chunk_tick_pool);
+
+        this->pending.clear();
+        for (size_t i = launched; i < order.size(); ++i)
+            this->pending.push_back(order[i].second);
+    }
+
+    /**
+     * @brief Starts the next job of a chunk.
+     * @param slot        Slot of the chunk inside the active grid.
+     * @param thread_pool Pool the job and its sub-tasks run in.
+     */
+    auto Platform::launch(u32 slot, threading::thread_pool::Tasksystem<> &thread_pool) -> void {
+        static auto generate = [](
+                chunk::Chunk *ptr,
+                threading::thread_pool::Tasksystem<> *pool) -> void {
+            ASSERT_EQ(ptr);
+            ptr->generate(*pool);
         };
 
-        static auto unloading_fun = [&](Unloading) -> PlatformState  {
-            if (!state.chunk_tick_pool.no_tasks())
-                return Unloading {};
+        static auto compress = [](
+                chunk::Chunk *ptr,
+                threading::thread_pool::Tasksystem<> *pool) -> void {
+            ASSERT_EQ(ptr);
+
+            // neighbors that finished generating meanwhile
+            if (ptr->unresolved_seams())
+                ptr->finalize_faces();
 
-            return Idle {};
+            ptr->recombine(*pool);
         };
 
-        static auto visitor = overload {
-            init_fun, idle_fun, loading_fun, compressing_fun, swapping_fun, unloading_fun
+        static auto seal = [](chunk::Chunk *ptr, std::atomic_bool *sealing) -> void {
+            ASSERT_EQ(ptr);
+            ptr->finalize_faces();
+            ptr->deduplicate();
+
+            // the chunk is rendered meanwhile, the edits were made on copies of its trees
+            ptr->publish();
+            sealing->store(false, std::memory_order_release);
         };
 
-        this->platform_state = std::visit(visitor, this->platform_state);
+        auto *chunk = this->active_chunks[slot];
+        ASSERT_EQ(chunk);
+
+        switch (this->stages[slot]) {
+            case Stage::QUEUED:
+                this->stages[slot] = Stage::GENERATING;
+                thread_pool.enqueue_detach(generate, chunk, &thread_pool);
+                break;
+
+            case Stage::GENERATED:
+                this->stages[slot] = Stage::COMPRESSING;
+                thread_pool.enqueue_detach(compress, chunk, &thread_pool);
+                break;
+
+            case Stage::UNSEALED:
+                this->stages[slot] = Stage::SEALING;
+                this->sealing[slot].store(true, std::memory_order_relaxed);
+                thread_pool.enqueue_detach(seal, chunk, &this->sealing[slot]);
+                break;
+
+            default:
+                return;
+        }
+
+        this->in_flight.push_back(slot);
     }
 
     /**
-     * @brief Unload chunks whose shared count is 1, meaning they are no in use in this cycle.
-     * @param thread_pool Threadpool to parallel destroy unused chunks.
+     * @brief Samples the movement of the camera since the last tick into a smoothed velocity.
+     * @param position Camera position on the xz plane.
+     * @param now      Begin of the current tick.
      */
-    auto Platform::unload_chunks(threading::thread_pool::Tasksystem<> &thread_pool) -> void {
+    auto Platform::predict(glm::vec2 position, std::chrono::steady_clock::time_point now) -> void {
+        const std::chrono::duration<f32> elapsed = now - this->last_sample;
+
+        // the first sample and stalls of the tick thread carry no usable velocity
+        if (this->last_sample.time_since_epoch().count() && elapsed.count() > 0.0F && elapsed.count() < 1.0F) {
+            const auto sample = (position - this->last_position) / elapsed.count();
+            this->velocity += (sample - this->velocity) * PREFETCH_SMOOTHING;
+        }
+
+        this->last_position = position;
+        this->last_sample = now;
+    }
+
+    /**
+     * @brief Generates chunks of the region the camera is heading to, extrapolated by
+     *        PREFETCH_HORIZON. Runs with the lowest priority, only once every chunk of the
+     *        current region has its job and the tick has budget left. The staged chunks are
+     *        neither linked nor drawn, the next shift adopts them instead of generating them.
+     * @param state The global state.
+     * @param start Begin of the current tick.
+     */
+    auto Platform::prefetch(state::State &state, std::chrono::steady_clock::time_point start) -> void {
+        static auto generate = [](
+                chunk::Chunk *ptr,
+                threading::thread_pool::Tasksystem<> *pool) -> void {
+            ASSERT_EQ(ptr);
+            ptr->generate(*pool);
+        };
+
         static auto destroy = [](chunk::Chunk *ptr) -> void {
             ASSERT_EQ(ptr);
             delete ptr;
         };
 
-        DEBUG_LOG("Unloading chunks");
+        if (!this->pending.empty())
+            return;
 
-        std::vector<decltype(this->chunks)::key_type> to_erase;
-        for (auto &[_, k] : this->queued_chunks) {
-            if (k == nullptr)
+        const auto predicted = this->last_position + this->velocity * PREFETCH_HORIZON;
+        const auto origin = glm::ivec2(predicted / static_cast<f32>(CHUNK_SIZE));
+        const auto current = glm::ivec2(this->current_root) / CHUNK_SIZE;
+
+        auto &pool = state.chunk_tick_pool;
+        u32 running = 0;
+
+        // the prediction changed, chunks the camera no longer heads to are dropped
+        for (auto it = this->staged.begin(); it != this->staged.end();) {
+            auto &entry = it->second;
+            const bool busy = entry.launched && !entry.chunk->is_generated();
+            running += busy;
+
+            if (!busy && !IN_REGION(origin, entry.chunk->coordinates())) {
+                pool.enqueue_detach(destroy, entry.chunk.release());
+                it = this->staged.erase(it);
                 continue;
+            }
+
+            ++it;
+        }
+
+        if (origin == current)
+            return;
+
+        // the part of the predicted region the current one does not cover
+        for (i32 x = -RENDER_RADIUS; x < RENDER_RADIUS && this->staged.size() < PREFETCH_CAPACITY; ++x) {
+            for (i32 z = -RENDER_RADIUS; z < RENDER_RADIUS && this->staged.size() < PREFETCH_CAPACITY; ++z) {
+                const auto coordinates = origin + glm::ivec2(x, z);
 
-            bool active = false;
-            for (const auto &[__, v] : this->active_chunks) {
-                if (v == nullptr)
+                if (!IN_REGION(origin, coordinates) || IN_REGION(current, coordinates))
                     continue;
 
-                if (k == v) {
-                    active = true;
-                    break;
-                }
-            }
+                const u64 key = STAGING_KEY(coordinates);
+                if (this->staged.contains(key) || this->cache.contains(coordinates) || this->edits.contains(key))
+                    continue;
 
-            if (!active) {
-                thread_pool.enqueue_detach(destroy, this->chunks[k].get());
-                to_erase.push_back(k);
+                const auto slot = GRID_SLOT(coordinates.x, coordinates.y);
+                this->staged.emplace(key, Staged {
+                        std::make_unique<chunk::Chunk>(static_cast<u16>(slot), coordinates), false
+                });
             }
         }
 
-        for (auto &k : to_erase)
-            this->chunks.erase(k);
+        const u32 limit = std::max<u32>(STREAMING_IN_FLIGHT, 1);
+        const u32 used = static_cast<u32>(this->in_flight.size()) + running;
+        if (used >= limit)
+            return;
 
-        this->queued_chunks.clear();
-    }
+        // chunks closest to the camera are reached first
+        thread_local std::vector<std::pair<f32, chunk::Chunk *>> order;
+        order.clear();
 
-    auto Platform::init_neighbors(i32 x, i32 z) -> void {
-        auto init_chunk_neighbours = [this](i32 i, i32 j, chunk::Position p1, chunk::Position p2) {
-            if ((j > -1 && j < MAX_RENDER_VOLUME) && this->queued_chunks.contains(j)) {
-                this->queued_chunks[i]->add_neigbor(p1, this->chunks[this->queued_chunks[j]]);
-                this->queued_chunks[j]->add_neigbor(p2, this->chunks[this->queued_chunks[i]]);
-            }
-        };
+        for (const auto &[key, entry] : this->staged) {
+            if (entry.launched)
+                continue;
 
-        if (DISTANCE_2D(glm::vec2(-0.5), glm::vec2(x - 1, z)) < RENDER_RADIUS) {
-            init_chunk_neighbours(
-                    INDEX(x, z), INDEX(x - 1, z),
-                    chunk::Position::BACK, chunk::Position::FRONT);
+            const auto center =
+                    glm::vec2(entry.chunk->coordinates() * CHUNK_SIZE) +
+                    static_cast<f32>(CHUNK_SIZE / 2);
+
+            order.emplace_back(glm::distance(center, this->last_position), entry.chunk.get());
         }
 
+        const size_t count = std::min<size_t>(limit - used, order.size());
+        std::partial_sort(order.begin(), order.begin() + count, order.end());
 
-        if (DISTANCE_2D(glm::vec2(-0.5), glm::vec2(x + 1, z)) < RENDER_RADIUS) {
-            init_chunk_neighbours(
-                    INDEX(x, z), INDEX(x + 1, z),
-                    chunk::Position::FRONT, chunk::Position::BACK);
+        for (size_t i = 0; i < count && std::chrono::steady_clock::now() - start < STREAMING_BUDGET; ++i) {
+            auto *chunk = order[i].second;
+            this->staged[STAGING_KEY(chunk->coordinates())].launched = true;
+            pool.enqueue_detach(generate, chunk, &pool);
         }
+    }
+
+    /**
+     * @brief Unload chunks that are no longer in use in this cycle.
+     *        Runs once the tick pool drained, no task follows a neighbor link meanwhile. Every
+     *        link to an unloaded chunk is cleared before any of them is handed to the pool for
+     *        destruction, the next loading phase only starts after the pool drained again.
+     * @param thread_pool Threadpool to parallel destroy unused chunks.
+     */
+    auto Platform::unload_chunks(threading::thread_pool::Tasksystem<> &thread_pool) -> void {
+        static auto destroy = [](chunk::Chunk *ptr) -> void {
+            ASSERT_EQ(ptr);
+            delete ptr;
+        };
+
+        // edits of dropped chunks are kept until a chunk at their coordinates is generated again
+        auto save = [this](const chunk::Chunk &chunk) -> void {
+            std::vector<u8> bytes;
+            if (chunk.serialize(bytes))
+                this->edits[STAGING_KEY(chunk.coordinates())] = std::move(bytes);
+        };
+
+        DEBUG_LOG("Unloading chunks");
 
-        if (DISTANCE_2D(glm::vec2(-0.5), glm::vec2(x, z - 1)) < RENDER_RADIUS) {
-            init_chunk_neighbours(
-                    INDEX(x, z), INDEX(x, z - 1),
-                    chunk::Position::LEFT, chunk::Position::RIGHT);
+        // the previous grid, chunks that kept their slot are still active
+        std::vector<chunk::Chunk *> to_erase;
+        for (u32 i = 0; i < this->queued_chunks.size(); ++i) {
+            auto *chunk = this->queued_chunks[i];
+
+            if (chunk && chunk != this->active_chunks[i]) {
+                chunk->detach();
+                to_erase.push_back(chunk);
+            }
         }
 
-        if (DISTANCE_2D(glm::vec2(-0.5), glm::vec2(x, z + 1)) < RENDER_RADIUS) {
-            init_chunk_neighbours(
-                    INDEX(x, z), INDEX(x, z + 1),
-                    chunk::Position::RIGHT, chunk::Position::LEFT);
+        for (auto *k : to_erase) {
+            auto ptr = std::move(this->chunks[k]);
+            this->chunks.erase(k);
+
+            // chunks that never got drawn are generated again anyway
+            if (!ptr->is_initialized()) {
+                save(*ptr);
+                thread_pool.enqueue_detach(destroy, ptr.release());
+                continue;
+            }
+
+            for (auto &evicted : this->cache.insert(std::move(ptr))) {
+                save(*evicted);
+                thread_pool.enqueue_detach(destroy, evicted.release());
+            }
         }
+
+        this->queued_chunks.fill(nullptr);
+
+        const auto stats = this->cache.stats();
+        rendering::interface::set_chunk_cache(stats.hits, stats.misses, stats.bytes, stats.entries);
     }
 
     /**
-     * @brief Load new chunks and share ownership of currently loaded chunks that are still
-     *        visible in the new region.
-     * @param thread_pool Threadpool to parallel generate new chunks.
-     * @param new_root    The center of the new region.
+     * @brief Links a chunk with its neighbors inside the queued grid in both directions.
+     *        A slot may hold a chunk of the opposite side of the region, thus the coordinates
+     *        are compared.
+     * @param chunk Newly loaded chunk.
      */
-    auto Platform::load_chunks(threading::thread_pool::Tasksystem<> &thread_pool) -> void {
-        static auto generate = [](chunk::Chunk *ptr, glm::vec2 root) -> void {
-            ASSERT_EQ(ptr);
-            ptr->generate(root);
+    auto Platform::init_neighbors(chunk::Chunk *chunk) -> void {
+        auto init_chunk_neighbours = [&](glm::ivec2 offset, chunk::Position p1, chunk::Position p2) {
+            const auto coordinates = chunk->coordinates() + offset;
+            auto *neighbor = this->queued_chunks[GRID_SLOT(coordinates.x, coordinates.y)];
+
+            if (neighbor && neighbor->coordinates() == coordinates) {
+                chunk->add_neigbor(p1, neighbor);
+                neighbor->add_neigbor(p2, chunk);
+            }
         };
 
+        init_chunk_neighbours({ -1,  0 }, chunk::Position::BACK, chunk::Position::FRONT);
+        init_chunk_neighbours({  1,  0 }, chunk::Position::FRONT, chunk::Position::BACK);
+        init_chunk_neighbours({  0, -1 }, chunk::Position::LEFT, chunk::Position::RIGHT);
+        init_chunk_neighbours({  0,  1 }, chunk::Position::RIGHT, chunk::Position::LEFT);
+    }
+
+    /**
+     * @brief Load the chunks of the new region. Chunks that are still visible keep their slot
+     *        in the toroidal grid and are neither moved nor re-indexed, only the newly exposed
+     *        ring is created, linked and queued for generation.
+     */
+    auto Platform::load_chunks() -> void {
+        const auto origin = glm::ivec2(this->new_root) / CHUNK_SIZE;
+        std::vector<chunk::Chunk *> loaded;
+
         for (i32 x = -RENDER_RADIUS; x < RENDER_RADIUS; ++x) {
             for (i32 z = -RENDER_RADIUS; z < RENDER_RADIUS; ++z) {
                 if (DISTANCE_2D(glm::vec2(-0.5), glm::vec2(x, z)) < RENDER_RADIUS) {
+                    const auto coordinates = origin + glm::ivec2(x, z);
+                    const auto slot = GRID_SLOT(coordinates.x, coordinates.y);
 
-                    // position of the (x, z) chunk in the coordinate space of
-                    // the old root
-                    auto old_pos =
-                            (glm::vec2(x, z) * static_cast<f32>(CHUNK_SIZE) +
-                            this->new_root - this->current_root) / static_cast<f32>(CHUNK_SIZE);
+                    auto *chunk = this->active_chunks[slot];
+                    if (chunk && chunk->coordinates() == coordinates) {
+                        this->queued_chunks[slot] = chunk;
+                        continue;
+                    }
 
-                    if (DISTANCE_2D(glm::vec2(-0.5), old_pos) < RENDER_RADIUS &&
-                        std::holds_alternative<Idle>(this->platform_state)) {
+                    // ownership is released to the thread pool once the chunk is unloaded
+                    std::unique_ptr<chunk::Chunk> ptr;
+                    Stage stage = Stage::QUEUED;
 
-                        this->queued_chunks[INDEX(x, z)] =
-                                this->active_chunks[INDEX(old_pos.x, old_pos.y)];
-                        init_neighbors(x, z);
+                    // the slot follows from the coordinates, cached and prefetched chunks are adopted as is
+                    if ((ptr = this->cache.take(coordinates))) {
+                        stage = Stage::READY;
                     }
-                    else {
-
-                        // uses and empty destructor because we can guarantee that the
-                        // destructor lambda of the threadpool will destroy the shared pointer
-                        // this needs to be done to ensure the race to 0 won't happen
-                        auto ptr = std::shared_ptr<chunk::Chunk>(
-                                new chunk::Chunk { static_cast<u16>(INDEX(x, z)) },
-                                [](auto *){});
-                        auto chunk = ptr.get();
+                    else if (auto node = this->staged.extract(STAGING_KEY(coordinates))) {
+                        ptr = std::move(node.mapped().chunk);
 
-                        this->chunks[chunk] = std::move(ptr);
-                        this->queued_chunks[INDEX(x, z)] = chunk;
-                        init_neighbors(x, z);
+                        if (node.mapped().launched) {
+                            ASSERT_EQ(ptr->is_generated());
+                            stage = Stage::GENERATED;
+                        }
+                    }
+                    else {
+                        ptr = std::make_unique<chunk::Chunk>(static_cast<u16>(slot), coordinates);
 
-                        // generate new chunk
-                        thread_pool.enqueue_detach(generate, chunk, this->new_root);
+                        if (auto node = this->edits.extract(STAGING_KEY(coordinates)))
+                            ptr->restore(std::move(node.mapped()));
                     }
 
+                    chunk = ptr.get();
+
+                    this->chunks[chunk] = std::move(ptr);
+                    this->queued_chunks[slot] = chunk;
+                    this->stages[slot] = stage;
+                    loaded.push_back(chunk);
                 }
             }
         }
-    }
 
-    auto Platform::compress_chunks(threading::thread_pool::Tasksystem<> &thread_pool) -> void {
-        static auto compress = [](chunk::Chunk *ptr) -> void {
-            ASSERT_EQ(ptr);
-            ptr->recombine();
-        };
-
-        for (auto &[k ,v] : this->queued_chunks) {
-            if (k == v->index())
-                thread_pool.enqueue_detach(compress, v);
-        }
+        // links between remaining chunks stay valid, every neighbor is known before generating
+        for (auto *chunk : loaded)
+            init_neighbors(chunk);
     }
 
     /**  @brief Sliding window principle to swap active chunks with the new region. */
@@ -239,11 +520,11 @@ namespace core::level::platform {
             std::swap(this->active_chunks, this->queued_chunks);
 
             this->active_chunks_vec.clear();
-            for (const auto &[k, v] : this->active_chunks)
-                this->active_chunks_vec.emplace_back(k, v);
+            for (auto *chunk : this->active_chunks)
+                if (chunk)
+                    this->active_chunks_vec.push_back(chunk);
 
             this->current_root = this->new_root;
-            this->queue_ready = true;
         }
     }
 
@@ -253,35 +534,17 @@ namespace core::level::platform {
      * @param camera      Active camera for this frame.
      */
     auto Platform::update(state::State &state) -> void {
-        static auto update_render_fun = [](
-                u16 idx,
-                chunk::Chunk *ptr,
-                state::State &state) -> void {
-            ptr->update_and_render(idx, state);
-        };
-
         static auto render_fun = [](
                 chunk::Chunk *ptr,
                 state::State &state) -> void {
             ptr->cull(state);
         };
 
-        // check if new chunks need to be added to the active pool
-        // try lock to ensure no amount of frame freeze happens
+        // chunks keep their slot across a swap, a new region is rendered without any remapping
         std::unique_lock lock { this->mutex };
-        
-        if (this->queue_ready) {
-            for (const auto& [k, v] : this->active_chunks_vec) {
-                state.render_pool.enqueue_detach(update_render_fun, k, v, state);
-            }
 
-            this->queue_ready = false;
-        }
-        else [[likely]] {
-            for (const auto& [_, v] : this->active_chunks_vec) {
-                state.render_pool.enqueue_detach(render_fun, v, state);
-            }
-        }
+        for (auto *chunk : this->active_chunks_vec)
+            state.render_pool.enqueue_detach(render_fun, chunk, state);
 
         state.render_pool.wait_for_tasks();
     }
@@ -299,10 +562,94 @@ namespace core::level::platform {
         root.z += (std::abs(pos.z) % CHUNK_SIZE > CHUNK_SIZE / 2) * ((pos.z > 0) - (pos.z <= 0));
 
         return {
-            this->active_chunks[INDEX(root.x,     root.z)],
-            this->active_chunks[INDEX(root.x + 1, root.z)],
-            this->active_chunks[INDEX(root.x,     root.z + 1)],
-            this->active_chunks[INDEX(root.x + 1, root.z + 1)]
+            active_chunk(root.x,     root.z),
+            active_chunk(root.x + 1, root.z),
+            active_chunk(root.x,     root.z + 1),
+            active_chunk(root.x + 1, root.z + 1)
         };
     }
-}
\ No newline at end of file
+
+    /**
+     * @brief  Looks up an active chunk in the toroidal grid.
+     * @param  x Chunk position relative to the current root.
+     * @param  z Chunk position relative to the current root.
+     * @return The chunk, nullptr if no chunk is loaded at the position.
+     */
+    auto Platform::active_chunk(i32 x, i32 z) const -> chunk::Chunk * {
+        const auto coordinates = glm::ivec2(this->current_root) / CHUNK_SIZE + glm::ivec2(x, z);
+        auto *chunk = this->active_chunks[GRID_SLOT(coordinates.x, coordinates.y)];
+
+        return chunk && chunk->coordinates() == coordinates ? chunk : nullptr;
+    }
+
+    /**
+     * @brief  Point query against the occupancy of the active chunks.
+     * @param  pos   World position of the voxel.
+     * @param  water Whether water counts as occupied.
+     * @return Boolean indicating if a voxel exists at the position, false outside of the loaded area
+     *         and inside chunks that did not finish generating.
+     */
+    auto Platform::occupied(const glm::ivec3 &pos, bool water) -> bool {
+        const auto root = glm::ivec3(this->current_root.x, 0, this->current_root.y);
+        const auto relative = pos - root;
+
+        const i32 x = static_cast<i32>(std::floor(static_cast<f32>(relative.x) / CHUNK_SIZE));
+        const i32 z = static_cast<i32>(std::floor(static_cast<f32>(relative.z) / CHUNK_SIZE));
+
+        if (x < -RENDER_RADIUS || x >= RENDER_RADIUS || z < -RENDER_RADIUS || z >= RENDER_RADIUS)
+            return false;
+
+        auto *chunk = active_chunk(x, z);
+        if (!chunk)
+            return false;
+
+        return chunk->occupied(relative - glm::ivec3(x, 0, z) * CHUNK_SIZE, water);
+    }
+
+    /**
+     * @brief Visits every leaf of the active chunks intersecting a box, the box may span
+     *        several chunks. Recombined volumes are visited once as a whole.
+     * @param aabb  World box, min inclusive and max exclusive.
+     * @param fun   Receives the volume of every intersecting leaf in world coordinates.
+     * @param water Whether water is queried as well.
+     */
+    auto Platform::query_box(
+            const util::aabb::AABB<i32> &aabb,
+            const std::function<void(const chunk::Cube &)> &fun,
+            bool water)
+            -> void {
+        const auto root = glm::ivec3(this->current_root.x, 0, this->current_root.y);
+        const auto min = aabb.min - root;
+        const auto max = aabb.max - root;
+
+        if (min.x >= max.x || min.y >= max.y || min.z >= max.z)
+            return;
+
+        auto chunk_of = [](i32 v) -> i32 {
+            return static_cast<i32>(std::floor(static_cast<f32>(v) / CHUNK_SIZE));
+        };
+
+        const i32 x_min = std::max(chunk_of(min.x), -RENDER_RADIUS);
+        const i32 x_max = std::min(chunk_of(max.x - 1), RENDER_RADIUS - 1);
+        const i32 z_min = std::max(chunk_of(min.z), -RENDER_RADIUS);
+        const i32 z_max = std::min(chunk_of(max.z - 1), RENDER_RADIUS - 1);
+
+        for (i32 x = x_min; x <= x_max; ++x) {
+            for (i32 z = z_min; z <= z_max; ++z) {
+                const auto *chunk = active_chunk(x, z);
+                if (!chunk)
+                    continue;
+
+                // every chunk only sees its part of the box, no volume is reported twice
+                const auto origin = glm::ivec3(x, 0, z) * CHUNK_SIZE;
+                auto local = util::aabb::AABB<i32> {};
+                local.min = glm::max(min - origin, glm::ivec3(0, min.y, 0));
+                local.max = glm::min(max - origin, glm::ivec3(CHUNK_SIZE, max.y, CHUNK_SIZE));
+
+                chunk->query_box(local, [&](const chunk::Cube &cube) -> void {
+                    fun(chunk::Cube { cube.min + origin + root, cube.edge, cube.voxel_ID, cube.water });
+                }, water);
+            }
+        }
+    }
+}
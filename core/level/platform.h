@@ -7,8 +7,10 @@
 
 #include <map>
 #include <queue>
+#include <chrono>
 
 #include "chunk/chunk.h"
+#include "chunk/chunk_cache.h"
 
 #include "../rendering/renderer.h"
 #include "../threading/thread_pool.h"
@@ -20,15 +22,53 @@
 
 #define MAX_RENDER_VOLUME (static_cast<u32>(RENDER_RADIUS * RENDER_RADIUS * 2 * 2))
 
+// slot of a chunk inside the toroidal grid, world chunk coordinates modulo the diameter
+#define GRID_SLOT(_x, _z) \
+    (static_cast<u32>(((_x) & (RENDER_RADIUS * 2 - 1)) + ((_z) & (RENDER_RADIUS * 2 - 1)) * (RENDER_RADIUS * 2)))
+
+static_assert(!(RENDER_RADIUS & (RENDER_RADIUS - 1)), "the grid is addressed with masks");
+
+// wall time a tick may spend on scheduling chunk jobs
+#define STREAMING_BUDGET std::chrono::microseconds(2000)
+
+// chunks with a job inside the tick pool at once, later jobs wait for their priority
+#define STREAMING_IN_FLIGHT (std::thread::hardware_concurrency())
+
+// distance added to chunks outside of the frustum, visible chunks are streamed first
+#define STREAMING_HIDDEN_PENALTY (RENDER_RADIUS * CHUNK_SIZE * 2.0F)
+
+// seconds the camera is extrapolated ahead to prefetch the region it is heading to
+#define PREFETCH_HORIZON 1.5F
+
+// weight of the latest sample inside the smoothed camera velocity
+#define PREFETCH_SMOOTHING 0.2F
+
+// chunks generated ahead of the region at once, staged until the region reaches them
+#define PREFETCH_CAPACITY (RENDER_RADIUS * 4)
+
 namespace core::level::platform {
     using namespace util;
 
     struct Init {};
-    struct Idle {};
-    struct Loading{};
-    struct Compressing{};
-    struct Swapping{};
-    struct Unloading{};
+    struct Streaming {};
+    struct Draining {};
+
+    /** @brief Progress of a chunk, at most one job per chunk is inside the tick pool */
+    enum Stage : u8 {
+        QUEUED,
+        GENERATING,
+        GENERATED,
+        COMPRESSING,
+        READY,
+        UNSEALED,
+        SEALING
+    };
+
+    /** @brief Chunk generated ahead of the region, neither linked nor drawn until adopted */
+    struct Staged {
+        std::unique_ptr<chunk::Chunk> chunk;
+        bool launched;
+    };
 
     template<typename ...Ts>
     struct overload : Ts... { using Ts::operator()...; };
@@ -36,7 +76,7 @@ namespace core::level::platform {
     template<typename ...Ts>
     overload(Ts...) -> overload<Ts...>;
 
-    using PlatformState = std::variant<Init, Idle, Loading, Compressing, Swapping, Unloading>;
+    using PlatformState = std::variant<Init, Streaming, Draining>;
 
     class Platform :
         public traits::Tickable<Platform>,
@@ -50,24 +90,60 @@ namespace core::level::platform {
         auto get_world_root() const -> glm::vec2;
         auto get_visible_faces(util::camera::Camera &camera) -> size_t;
         auto get_nearest_chunks(const glm::ivec3 &) -> std::array<chunk::Chunk *, 4>;
+        auto occupied(const glm::ivec3 &, bool water = true) -> bool;
+        auto query_box(
+                const util::aabb::AABB<i32> &,
+                const std::function<void(const chunk::Cube &)> &,
+                bool water = true)
+                -> void;
 
     private:
         auto unload_chunks(threading::thread_pool::Tasksystem<> &) -> void;
-        auto load_chunks(threading::thread_pool::Tasksystem<> &) -> void;
-        auto compress_chunks(threading::thread_pool::Tasksystem<> &) -> void;
+        auto load_chunks() -> void;
         auto swap_chunks() -> void;
-        auto init_neighbors(i32 x, i32 z) -> void;
+        auto shift(threading::thread_pool::Tasksystem<> &) -> void;
+        auto retire() -> void;
+        auto dispatch(state::State &, std::chrono::steady_clock::time_point) -> void;
+        auto launch(u32, threading::thread_pool::Tasksystem<> &) -> void;
+        auto predict(glm::vec2, std::chrono::steady_clock::time_point) -> void;
+        auto prefetch(state::State &, std::chrono::steady_clock::time_point) -> void;
+        auto init_neighbors(chunk::Chunk *) -> void;
+        auto active_chunk(i32 x, i32 z) const -> chunk::Chunk *;
+
+        std::unordered_map<chunk::Chunk *, std::unique_ptr<chunk::Chunk>> chunks;
+
+        // toroidal grids addressed by GRID_SLOT, a chunk keeps its slot while it is loaded
+        std::array<chunk::Chunk *, MAX_RENDER_VOLUME> active_chunks {};
+        std::array<chunk::Chunk *, MAX_RENDER_VOLUME> queued_chunks {};
+
+        std::vector<chunk::Chunk *> active_chunks_vec;
+
+        // stage of the chunk inside the same slot of the active grid
+        std::array<Stage, MAX_RENDER_VOLUME> stages {};
+        std::array<std::atomic_bool, MAX_RENDER_VOLUME> sealing {};
+
+        // slots waiting for their next job and slots whose job is inside the tick pool
+        std::vector<u32> pending;
+        std::vector<u32> in_flight;
+
+        // prefetched chunks keyed by their packed coordinates, only touched by the tick thread
+        std::unordered_map<u64, Staged> staged;
+
+        // chunks that left the region, reused if the region moves back
+        chunk::ChunkCache cache;
 
-        std::unordered_map<chunk::Chunk *, std::shared_ptr<chunk::Chunk>> chunks;
-        std::unordered_map<u32, chunk::Chunk *> active_chunks;
-        std::unordered_map<u32, chunk::Chunk *> queued_chunks;
+        // edited segments of chunks dropped from the cache keyed by their packed coordinates,
+        // restored once a chunk at the same coordinates is generated again
+        std::unordered_map<u64, std::vector<u8>> edits;
 
-        std::vector<std::pair<u32, chunk::Chunk *>> active_chunks_vec;
+        // smoothed camera velocity in world units per second
+        glm::vec2 velocity       = {0.0F, 0.0F};
+        glm::vec2 last_position  = {0.0F, 0.0F};
+        std::chrono::steady_clock::time_point last_sample;
 
         glm::vec2 current_root   = {0.0F, 0.0F};
         glm::vec2 new_root = {0.0F, 0.0F};
         std::mutex mutex;
-        std::atomic<bool> queue_ready    = false;
 
         PlatformState platform_state;
     };
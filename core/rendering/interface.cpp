@@ -3,6 +3,7 @@
 //
 
 #include <iostream>
+#include <atomic>
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
@@ -25,6 +26,12 @@ namespace core::rendering::interface {
     static f64 lastFrame = 0;
     static u64 draw_calls = 0;
 
+    // written by the tick thread whenever chunks are unloaded
+    static std::atomic<u64> cache_hits { 0 };
+    static std::atomic<u64> cache_misses { 0 };
+    static std::atomic<size_t> cache_bytes { 0 };
+    static std::atomic<size_t> cache_entries { 0 };
+
     auto init(GLFWwindow *window) -> void {
         IMGUI_CHECKVERSION();
 
@@ -75,6 +82,13 @@ namespace core::rendering::interface {
         draw_calls = amount;
     }
 
+    auto set_chunk_cache(u64 hits, u64 misses, size_t bytes, size_t entries) -> void {
+        cache_hits.store(hits, std::memory_order_relaxed);
+        cache_misses.store(misses, std::memory_order_relaxed);
+        cache_bytes.store(bytes, std::memory_order_relaxed);
+        cache_entries.store(entries, std::memory_order_relaxed);
+    }
+
     auto render() -> void {
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -110,6 +124,14 @@ namespace core::rendering::interface {
         ImGui::Text("fps:        %s",    std::to_string(fps).c_str());
         ImGui::Text("\n------------------\n\n");
         ImGui::Text("camera:     %.1f %.1f %.1f", camera.x, camera.y, camera.z);
+        ImGui::Text("\n------------------\n\n");
+        const u64 hits = cache_hits.load(std::memory_order_relaxed);
+        const u64 lookups = hits + cache_misses.load(std::memory_order_relaxed);
+
+        ImGui::Text("cache:      %s chunks", std::to_string(cache_entries.load(std::memory_order_relaxed)).c_str());
+        ImGui::Text("memory:     %.1f MiB", static_cast<f64>(cache_bytes.load(std::memory_order_relaxed)) / (1 << 20));
+        ImGui::Text("hit rate:   %.1f %%",
+                    lookups ? 100.0 * static_cast<f64>(hits) / static_cast<f64>(lookups) : 0.0);
         ImGui::End();
 
         ImGui::Render();
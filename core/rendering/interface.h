@@ -20,6 +20,7 @@ namespace core::rendering::interface {
     auto set_render_time(std::chrono::microseconds interval) -> void;
     auto add_wait_time(std::chrono::microseconds interval) -> void;
     auto set_draw_calls(u64) -> void;
+    auto set_chunk_cache(u64 hits, u64 misses, size_t bytes, size_t entries) -> void;
     auto render() -> void;
 };
 
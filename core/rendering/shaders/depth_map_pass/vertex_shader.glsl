@@ -8,13 +8,16 @@ uniform vec2 worldbase;
 uniform uint render_radius;
 
 // decompress world space position
+// the chunk index is the slot of the chunk inside a toroidal grid, world chunk coordinates
+// modulo the diameter, relative to the world base it is the chunk of the region with that slot
 vec3 world_space_chunk_pos() {
     int chunk_index = int(high >> 20U);
     int render_diameter = int(render_radius * 2U);
+    vec2 region_min = worldbase / 32.0F - float(render_radius);
 
-    float x = float((chunk_index % render_diameter) - int(render_radius));
+    float x = mod(float(chunk_index % render_diameter) - region_min.x, float(render_diameter)) - float(render_radius);
     float y = float((high >> 16) & 0xFU);
-    float z = float((chunk_index / render_diameter) - int(render_radius));
+    float z = mod(float(chunk_index / render_diameter) - region_min.y, float(render_diameter)) - float(render_radius);
 
     return 32.0F * vec3(x, y, z);
 }
@@ -0,0 +1,162 @@
+//
+// Created by Luis Ruisinger on 10.11.24.
+//
+
+#include <bit>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "../core/level/chunk_data_structure/node_kernels.h"
+#include "../util/culling.h"
+
+using namespace core::level;
+
+#define CHECK(_c)                                                        \
+    do {                                                                 \
+        if (!(_c)) {                                                     \
+            std::fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #_c); \
+            ++failures;                                                  \
+        }                                                                \
+    } while (0)
+
+static i32 failures = 0;
+
+/** @brief Children of a node, every other block shares one leaf with single bits flipped */
+static auto randomize(std::mt19937_64 &rng, node::NodePool::Block &children, bool similar) -> void {
+    const u64 base = rng() & ~(static_cast<u64>(0xFF) << 0x38);
+
+    for (auto &child : children) {
+        child.packed_data = similar ? base : rng();
+        child.nodes = static_cast<u32>(rng());
+
+        if (!(rng() % 7))
+            child.packed_data ^= static_cast<u64>(1) << (rng() % 64);
+    }
+}
+
+/** @brief Every variant supported by the executing cpu answers like the scalar kernels */
+static auto equivalence(util::cpu::Isa isa) -> void {
+    const auto &reference = node_kernels::select(util::cpu::SCALAR);
+    const auto &kernels   = node_kernels::select(isa);
+    CHECK(kernels.isa == isa);
+
+    std::mt19937_64 rng(11);
+    node::NodePool::Block children;
+
+    i32 combinable = 0;
+    for (i32 i = 0; i < 100000; ++i) {
+        randomize(rng, children, i & 0x1);
+
+        const bool expected = reference.check_combinable(children);
+        combinable += expected;
+
+        CHECK(kernels.check_combinable(children) == expected);
+        CHECK(kernels.combine_faces(children) == reference.combine_faces(children));
+    }
+
+    // both outcomes have to be covered
+    CHECK(combinable > 0 && combinable < 100000);
+
+    std::vector<u64> faces(257);
+    for (auto &face : faces)
+        face = rng();
+
+    VERTEX mesh;
+    for (auto &vertex : mesh.vertices)
+        vertex = rng();
+
+    const u64 placement = rng();
+    std::vector<VERTEX> expected(faces.size());
+    std::vector<VERTEX> actual(faces.size());
+
+    reference.emit_faces(mesh, placement, faces.data(), faces.size(), expected.data());
+    kernels.emit_faces(mesh, placement, faces.data(), faces.size(), actual.data());
+
+    for (size_t i = 0; i < faces.size(); ++i)
+        CHECK(actual[i].vertices == expected[i].vertices);
+
+    for (i32 i = 0; i < 64; ++i) {
+        auto occupancy = std::make_unique<chunk::Occupancy::Rows>();
+        auto cullers   = std::make_unique<chunk::Occupancy::Padded>();
+        auto x_neg     = std::make_unique<chunk::Occupancy::Rows>();
+        auto x_pos     = std::make_unique<chunk::Occupancy::Rows>();
+
+        // sparse and dense volumes alike
+        const u32 density = i & 0x1 ? UINT32_MAX : static_cast<u32>(rng());
+        for (auto *rows : { occupancy.get(), x_neg.get(), x_pos.get() })
+            for (auto &row : *rows)
+                row = static_cast<u32>(rng()) & density;
+
+        for (auto &row : *cullers)
+            row = static_cast<u32>(rng()) & density;
+
+        auto exposed = std::make_unique<std::array<chunk::Occupancy::Rows, 6>>();
+        auto swept   = std::make_unique<std::array<chunk::Occupancy::Rows, 6>>();
+
+        reference.expose(*occupancy, *cullers, *x_neg, *x_pos, *exposed);
+        kernels.expose(*occupancy, *cullers, *x_neg, *x_pos, *swept);
+
+        CHECK(*swept == *exposed);
+    }
+}
+
+/** @brief The frustum kernels supported by the executing cpu classify like the scalar kernels */
+static auto frustum(util::cpu::Isa isa) -> void {
+    const auto &reference = util::culling::select(util::cpu::SCALAR);
+    const auto &kernels   = util::culling::select(isa);
+
+    std::mt19937 rng(19);
+    std::uniform_real_distribution<f32> position(-256.0F, 256.0F);
+    std::uniform_real_distribution<f32> radius(0.0F, 48.0F);
+
+    u32 outside = 0, inside = 0;
+    for (i32 i = 0; i < 256; ++i) {
+        util::culling::Frustum frustum;
+        frustum.set_cam_internals(45.0F + position(rng) / 16.0F, 16.0F / 9.0F, 0.1F, 256.0F);
+        frustum.set_cam_definition(
+                glm::vec3 { position(rng), position(rng), position(rng) },
+                glm::vec3 { position(rng), position(rng), position(rng) },
+                glm::vec3 { 0.0F, 1.0F, 0.0F });
+
+        for (i32 j = 0; j < 64; ++j) {
+            util::culling::Spheres spheres;
+            for (u8 k = 0; k < 8; ++k) {
+                spheres.x[k] = position(rng);
+                spheres.y[k] = position(rng);
+                spheres.z[k] = position(rng);
+                spheres.radius[k] = radius(rng);
+            }
+
+            const auto expected = reference.spheres_visible_type(frustum, spheres);
+            const auto actual   = kernels.spheres_visible_type(frustum, spheres);
+
+            CHECK(actual.outside == expected.outside && actual.inside == expected.inside);
+            outside += std::popcount(expected.outside);
+            inside  += std::popcount(expected.inside);
+        }
+    }
+
+    // every classification has to be covered
+    CHECK(outside > 0 && inside > 0 && outside + inside < 256 * 64 * 8);
+}
+
+auto main() -> int {
+    const auto detected = util::cpu::detect();
+    CHECK(node_kernels::kernels.isa == detected);
+
+    for (auto isa : { util::cpu::SCALAR, util::cpu::AVX2, util::cpu::AVX512 }) {
+        if (isa > detected)
+            break;
+
+        std::printf("%s\n", util::cpu::name(isa));
+        equivalence(isa);
+        frustum(isa);
+    }
+
+    if (failures)
+        std::fprintf(stderr, "%d checks failed\n", failures);
+
+    return failures ? 1 : 0;
+}
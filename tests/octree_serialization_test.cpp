@@ -0,0 +1,150 @@
+//
+// Created by Luis Ruisinger on 09.11.24.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+
+#include "../core/level/chunk_data_structure/octree.h"
+
+using namespace core::level;
+
+#define CHECK(_c)                                                        \
+    do {                                                                 \
+        if (!(_c)) {                                                     \
+            std::fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #_c); \
+            ++failures;                                                  \
+        }                                                                \
+    } while (0)
+
+static i32 failures = 0;
+
+/** @brief Visible faces of a tree in a stable order */
+static auto faces(const octree::Octree &tree) -> std::vector<u64> {
+    std::array<std::vector<u64>, 6> streams;
+    tree.stream(streams);
+
+    std::vector<u64> flat;
+    for (const auto &stream : streams)
+        flat.insert(flat.end(), stream.begin(), stream.end());
+
+    std::sort(flat.begin(), flat.end());
+    return flat;
+}
+
+/** @brief Tree of random boxes with random holes, shared with the dag if requested */
+static auto build(std::mt19937 &rng, bool shared) -> std::unique_ptr<octree::Octree> {
+    auto tree = std::make_unique<octree::Octree>();
+
+    for (i32 i = 0; i < 6; ++i) {
+        util::aabb::AABB<i32> box;
+        for (u8 j = 0; j < 3; ++j) {
+            const i32 a = static_cast<i32>(rng() % (CHUNK_SIZE + 1));
+            const i32 b = static_cast<i32>(rng() % (CHUNK_SIZE + 1));
+
+            box.min[j] = std::min(a, b);
+            box.max[j] = std::max(a, b);
+        }
+
+        tree->fill(box, static_cast<u16>(1 + rng() % 4));
+    }
+
+    for (i32 i = 0; i < 200; ++i) {
+        i32 changed = 0;
+        tree->removePoint(static_cast<u16>(((rng() % 32) << 10) | ((rng() % 32) << 5) | (rng() % 32)), changed);
+    }
+
+    if (shared)
+        tree->deduplicate();
+
+    return tree;
+}
+
+static auto round_trip() -> void {
+    std::mt19937 rng(5);
+
+    for (i32 i = 0; i < 40; ++i) {
+        const auto tree = build(rng, i & 0x1);
+
+        std::vector<u8> bytes;
+        tree->serialize(bytes);
+
+        octree::Octree loaded;
+        CHECK(loaded.deserialize(bytes).isOk());
+        CHECK(faces(loaded) == faces(*tree));
+        CHECK(loaded.histogram().leaves == tree->histogram().leaves);
+
+        // the loaded tree stays editable
+        loaded.addPoint((static_cast<u64>((0 << 13) | (0 << 8) | (0 << 3) | 0x7) << SHIFT_HIGH) | 1);
+        CHECK(loaded.histogram().leaves > 0);
+    }
+
+    octree::Octree empty;
+    std::vector<u8> bytes;
+    empty.serialize(bytes);
+
+    octree::Octree loaded;
+    CHECK(loaded.deserialize(bytes).isOk());
+    CHECK(faces(loaded).empty());
+}
+
+static auto rejection() -> void {
+    std::mt19937 rng(7);
+    const auto tree = build(rng, false);
+
+    std::vector<u8> bytes;
+    tree->serialize(bytes);
+
+    auto reject = [&](std::vector<u8> corrupted, serialization::Error expected) -> void {
+        octree::Octree loaded;
+        const auto result = loaded.deserialize(corrupted);
+
+        CHECK(result.isErr() && result.unwrapErr() == expected);
+        CHECK(faces(loaded).empty());
+    };
+
+    auto truncated = bytes;
+    truncated.resize(truncated.size() - 8);
+    reject(truncated, serialization::Error::TRUNCATED);
+
+    auto magic = bytes;
+    magic[0] ^= 0x1;
+    reject(magic, serialization::Error::INVALID_MAGIC);
+
+    auto version = bytes;
+    version[4] ^= 0x1;
+    reject(version, serialization::Error::UNSUPPORTED_VERSION);
+
+    // the first child of the first block points back to the block itself
+    auto cycle = bytes;
+    const size_t child = sizeof(serialization::Header) + sizeof(node::Node);
+
+    bool linked = false;
+    for (u8 i = 0; i < 8 && !linked; ++i) {
+        u64 packed_data;
+        std::memcpy(&packed_data, cycle.data() + child + i * sizeof(node::Node), sizeof(u64));
+
+        if (packed_data >> 0x38) {
+            const u32 block = 0;
+            std::memcpy(cycle.data() + child + i * sizeof(node::Node) + 0x8, &block, sizeof(u32));
+            linked = true;
+        }
+    }
+
+    CHECK(linked);
+
+    reject(cycle, serialization::Error::CORRUPTED);
+}
+
+auto main() -> int {
+    round_trip();
+    rejection();
+
+    if (failures)
+        std::fprintf(stderr, "%d checks failed\n", failures);
+
+    return failures ? 1 : 0;
+}
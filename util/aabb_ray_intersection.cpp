@@ -2,12 +2,19 @@
 // Created by Luis Ruisinger on 28.08.24.
 //
 
-#include "aabb_ray_intersection.h"
-#include "aabb.h"
+#include <limits>
 
-#define MAX_INTERACTION_RANGE 6
+#include "aabb_ray_intersection.h"
 
 namespace util::aabb_ray_intersection {
+
+    /** @brief Face a voxel is entered through when stepping in positive / negative direction per axis */
+    static constexpr const u64 entry_faces[3][2] = {
+            { LEFT_BIT,   RIGHT_BIT },
+            { BOTTOM_BIT, TOP_BIT   },
+            { BACK_BIT,   FRONT_BIT }
+    };
+
     Ray::Ray(const glm::vec3 &origin, const glm::vec3 &direction)
         : origin    { origin    },
           direction { direction }
@@ -15,50 +22,51 @@ namespace util::aabb_ray_intersection {
         this->direction = glm::normalize(this->direction);
     }
 
-    auto Ray::intersect(core::level::platform::Platform &platform) -> Intersection {
-        const auto chunks = platform.get_nearest_chunks(this->origin);
-        const auto &world_root = platform.get_world_root();
-        this->origin.x -= world_root.x;
-        this->origin.z -= world_root.y;
-
-        static std::function<f32(const glm::vec3 &, const u32)> fun =
-                [this](const glm::vec3 &pos, const u32 scale) -> f32 {
-                        try {
-                            if (scale == BASE_SIZE) {
-                                return aabb::AABB<f32>()
-                                        .translate(pos)
-                                        .translate(0.5F)
-                                        .intersection(this->origin, this->direction);
-                            }
-                            else {
-                                return aabb::AABB<f32>()
-                                        .translate(pos)
-                                        .scale_center(static_cast<f32>(scale))
-                                        .scale_center(0.5F)
-                                        .intersection(this->origin, this->direction);
-                            }
-                        }
-                        catch (std::exception &err) {
-                            LOG(err.what());
-                        }
-
-                        // fallback on undefined error
-                        return std::numeric_limits<f32>::max();
-                };
-
-        auto ray_scale = std::numeric_limits<f32>::max();
-        for (const auto chunk : chunks) {
-            if (!chunk)
-                continue;
-
-            auto ret = chunk->find(fun);
-            ray_scale = ret < ray_scale ? ret : ray_scale;
+    /**
+     * @brief  Traverses the voxels pierced by the ray in order (Amanatides & Woo)
+     *         and tests each against the occupancy of the loaded chunks.
+     *         At most ~3 * MAX_INTERACTION_RANGE voxels are visited.
+     * @param  platform The platform containing the loaded chunks.
+     * @return The first solid voxel inside the interaction range.
+     */
+    auto Ray::intersect(core::level::platform::Platform &platform) const -> Intersection {
+        static constexpr const f32 infinity = std::numeric_limits<f32>::max();
+
+        auto voxel = glm::ivec3(glm::floor(this->origin));
+
+        glm::ivec3 step;
+        glm::vec3  delta;
+        glm::vec3  next;
+
+        for (u8 axis = 0; axis < 3; ++axis) {
+            const f32 d = this->direction[axis];
+
+            step[axis]  = (d > 0.0F) - (d < 0.0F);
+            delta[axis] = d != 0.0F ? std::abs(1.0F / d) : infinity;
+
+            // distance along the ray to the first boundary of the axis
+            next[axis] = d > 0.0F ? (static_cast<f32>(voxel[axis] + 1) - this->origin[axis]) / d :
+                         d < 0.0F ? (static_cast<f32>(voxel[axis])     - this->origin[axis]) / d :
+                                    infinity;
         }
 
-        if (ray_scale > 6)
-            return std::nullopt;
+        u64 face = 0;
+        f32 distance = 0.0F;
+
+        while (distance <= MAX_INTERACTION_RANGE) {
+            if (platform.occupied(voxel, false))
+                return Hit { voxel, face, distance };
+
+            const u8 axis = next.x < next.y
+                    ? (next.x < next.z ? 0 : 2)
+                    : (next.y < next.z ? 1 : 2);
+
+            distance     = next[axis];
+            voxel[axis] += step[axis];
+            next[axis]  += delta[axis];
+            face         = entry_faces[axis][step[axis] < 0];
+        }
 
-        auto pair = std::make_pair(this->origin, ray_scale * this->direction);
-        return std::make_optional(std::move(pair));
+        return std::nullopt;
     }
-}
\ No newline at end of file
+}
@@ -9,16 +9,31 @@
 
 #include "../core/level/platform.h"
 
+#define MAX_INTERACTION_RANGE 6
+
 namespace util::aabb_ray_intersection {
-    using Intersection = std::optional<std::pair<glm::vec3, glm::vec3>>;
+
+    /** @brief First voxel hit by a ray */
+    struct Hit {
+
+        // world position of the voxel
+        glm::ivec3 voxel;
+
+        // face the ray entered the voxel through (LEFT_BIT ... BACK_BIT), 0 if it started inside
+        u64 face;
+
+        // distance from the origin of the ray to the entry point
+        f32 distance;
+    };
+
+    using Intersection = std::optional<Hit>;
 
     struct Ray {
         Ray(const glm::vec3 &, const glm::vec3 &);
 
-        // if intersection succeeds with a node
-        // we return the 1^3 position of hit node
-        // must keep in mind voxels bigger than base size
-        auto intersect(core::level::platform::Platform &) -> Intersection;
+        // walks the voxel grid front to back and stops at the first occupied voxel
+        // or once MAX_INTERACTION_RANGE is exceeded
+        auto intersect(core::level::platform::Platform &) const -> Intersection;
 
         glm::vec3 origin;
         glm::vec3 direction;
@@ -151,6 +151,10 @@ namespace util::camera {
         return this->frustum.cube_visible_type(p, s);
     }
 
+    auto Camera::frustum_collision(const culling::Spheres &s) const -> culling::Classification {
+        return this->frustum.spheres_visible_type(s);
+    }
+
     auto Camera::get_position() const -> glm::vec3 {
         return this->position;
     }
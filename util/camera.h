@@ -64,6 +64,7 @@ namespace util::camera {
         auto check_in_frustum(glm::vec2, u32) const -> bool;
         auto frustum_collision(glm::vec3, u32 ) const -> culling::CollisionType;
         auto frustum_collision(glm::vec2, u32) const -> culling::CollisionType;
+        auto frustum_collision(const culling::Spheres &) const -> culling::Classification;
 
         auto get_position() const -> glm::vec3;
         auto get_front() const ->  glm::vec3;
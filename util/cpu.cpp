@@ -0,0 +1,33 @@
+//
+// Created by Luis Ruisinger on 20.10.24.
+//
+
+#include "cpu.h"
+
+namespace util::cpu {
+
+    /**
+     * @brief  Queries cpuid for the best instruction set supported by the executing cpu.
+     * @return The best supported instruction set, SCALAR if none is known.
+     */
+    auto detect() -> Isa {
+#ifdef CPU_DISPATCH
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl"))
+            return AVX512;
+
+        if (__builtin_cpu_supports("avx2"))
+            return AVX2;
+#endif
+        return SCALAR;
+    }
+
+    auto name(Isa isa) -> const char * {
+        switch (isa) {
+            case AVX512: return "AVX-512";
+            case AVX2:   return "AVX2";
+            default:     return "scalar";
+        }
+    }
+}
@@ -0,0 +1,29 @@
+//
+// Created by Luis Ruisinger on 20.10.24.
+//
+
+#ifndef OPENGL_3D_ENGINE_CPU_H
+#define OPENGL_3D_ENGINE_CPU_H
+
+#include "defines.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define CPU_DISPATCH
+    #define TARGET_AVX2   __attribute__((target("avx2")))
+    #define TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512vl")))
+#endif
+
+namespace util::cpu {
+
+    /** @brief Instruction sets the SIMD kernels are compiled for, ordered by preference */
+    enum Isa : u8 {
+        SCALAR,
+        AVX2,
+        AVX512
+    };
+
+    auto detect() -> Isa;
+    auto name(Isa) -> const char *;
+}
+
+#endif //OPENGL_3D_ENGINE_CPU_H
@@ -3,8 +3,13 @@
 //
 
 #include "culling.h"
+#include "cpu.h"
 #include "log.h"
 
+#ifdef CPU_DISPATCH
+#include <immintrin.h>
+#endif
+
 namespace util::culling {
     auto Frustum::set_cam_internals(f32 angle, f32 ratio, f32 nearD, f32 farD) -> void {
         this->ratio = ratio;
@@ -48,6 +53,103 @@ namespace util::culling {
         return cirle_frustuM_collision(point, radius);
     }
 
+    /**
+     * @brief  Classifies 8 spheres against the frustum in one pass.
+     *         Matches sphere_frustum_collision lane by lane.
+     * @param  spheres Centers and radii of the spheres.
+     * @return Bit masks of the spheres outside and completely inside the frustum.
+     */
+    auto Frustum::spheres_visible_type(const Spheres &spheres) const -> Classification {
+        return kernels.spheres_visible_type(*this, spheres);
+    }
+
+    namespace scalar {
+        auto spheres_visible_type(const Frustum &frustum, const Spheres &spheres) -> Classification {
+            Classification classification { 0, 0 };
+
+            for (u8 i = 0; i < 8; ++i) {
+                const auto type = frustum.sphere_frustum_collision(
+                        glm::vec3 { spheres.x[i], spheres.y[i], spheres.z[i] }, spheres.radius[i]);
+
+                classification.outside |= (type == OUTSIDE) << i;
+                classification.inside  |= (type == INSIDE)  << i;
+            }
+
+            return classification;
+        }
+    }
+
+    namespace avx2 {
+#ifdef CPU_DISPATCH
+        /** @brief Dot product of 8 vectors in SoA layout with a single axis */
+        TARGET_AVX2
+        static auto dot(__m256 x, __m256 y, __m256 z, const glm::vec3 &axis) -> __m256 {
+            return _mm256_add_ps(
+                    _mm256_add_ps(
+                            _mm256_mul_ps(x, _mm256_set1_ps(axis.x)),
+                            _mm256_mul_ps(y, _mm256_set1_ps(axis.y))),
+                    _mm256_mul_ps(z, _mm256_set1_ps(axis.z)));
+        }
+
+        TARGET_AVX2
+        auto spheres_visible_type(const Frustum &frustum, const Spheres &spheres) -> Classification {
+            const __m256 _x = _mm256_sub_ps(_mm256_load_ps(spheres.x.data()), _mm256_set1_ps(frustum.cam_pos.x));
+            const __m256 _y = _mm256_sub_ps(_mm256_load_ps(spheres.y.data()), _mm256_set1_ps(frustum.cam_pos.y));
+            const __m256 _z = _mm256_sub_ps(_mm256_load_ps(spheres.z.data()), _mm256_set1_ps(frustum.cam_pos.z));
+            const __m256 _r = _mm256_load_ps(spheres.radius.data());
+
+            // |v| by clearing the sign bit
+            const __m256 _abs = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+
+            const __m256 _az   = dot(_x, _y, _z, frustum.z_vec);
+            const __m256 _ay   = _mm256_and_ps(dot(_x, _y, _z, frustum.y_vec), _abs);
+            const __m256 _ax   = _mm256_and_ps(dot(_x, _y, _z, frustum.x_vec), _abs);
+            const __m256 _az_t = _mm256_mul_ps(_az, _mm256_set1_ps(frustum.tang));
+            const __m256 _az_x = _mm256_mul_ps(_az_t, _mm256_set1_ps(frustum.ratio));
+            const __m256 _sr   = _mm256_mul_ps(_r, _mm256_set1_ps(frustum.sphere_factor_x));
+
+            const __m256 _near = _mm256_set1_ps(frustum.near_distance);
+            const __m256 _far  = _mm256_set1_ps(frustum.far_distance);
+
+            __m256 _outside = _mm256_or_ps(
+                    _mm256_cmp_ps(_az, _near, _CMP_LT_OQ),
+                    _mm256_cmp_ps(_az, _far,  _CMP_GT_OQ));
+            _outside = _mm256_or_ps(_outside, _mm256_cmp_ps(_ay, _mm256_add_ps(_az_t, _sr), _CMP_GT_OQ));
+            _outside = _mm256_or_ps(_outside, _mm256_cmp_ps(_ax, _mm256_add_ps(_az_x, _sr), _CMP_GT_OQ));
+
+            __m256 _inside = _mm256_and_ps(
+                    _mm256_cmp_ps(_mm256_sub_ps(_az, _r), _near, _CMP_GE_OQ),
+                    _mm256_cmp_ps(_mm256_add_ps(_az, _r), _far,  _CMP_LE_OQ));
+            _inside = _mm256_and_ps(_inside, _mm256_cmp_ps(_ay, _mm256_sub_ps(_az_t, _sr), _CMP_LE_OQ));
+            _inside = _mm256_and_ps(_inside, _mm256_cmp_ps(_ax, _mm256_sub_ps(_az_x, _sr), _CMP_LE_OQ));
+
+            const u8 outside = static_cast<u8>(_mm256_movemask_ps(_outside));
+            const u8 inside  = static_cast<u8>(_mm256_movemask_ps(_inside)) & ~outside;
+
+            return { outside, inside };
+        }
+#else
+        auto spheres_visible_type(const Frustum &frustum, const Spheres &spheres) -> Classification {
+            return scalar::spheres_visible_type(frustum, spheres);
+        }
+#endif
+    }
+
+    auto select(cpu::Isa isa) -> const Kernels & {
+        static const Kernels scalar_kernels = { cpu::SCALAR, scalar::spheres_visible_type };
+
+#ifdef CPU_DISPATCH
+        // 8 spheres fill a 256 bit register, AVX-512 uses the AVX2 classification
+        static const Kernels avx2_kernels = { cpu::AVX2, avx2::spheres_visible_type };
+
+        if (isa >= cpu::AVX2)
+            return avx2_kernels;
+#endif
+        return scalar_kernels;
+    }
+
+    const Kernels &kernels = select(cpu::detect());
+
     auto Frustum::sphere_frustum_collision(
             const glm::vec3 &point, f32 radius) const -> CollisionType {
         glm::vec3 v = point - this->cam_pos;
@@ -72,7 +174,13 @@ namespace util::culling {
             return OUTSIDE;
         }
 
-        return INSIDE;
+        // the sphere does not reach any plane, descendants need no further tests
+        if (az - radius >= this->near_distance && az + radius <= this->far_distance &&
+            std::abs(ay) <= az_t - sr && std::abs(ax) <= max_az_x - sr) {
+            return INSIDE;
+        }
+
+        return INTERSECT;
     }
 
     auto Frustum::cirle_frustuM_collision(
@@ -8,7 +8,10 @@
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
+#include <array>
+
 #include "defines.h"
+#include "cpu.h"
 
 #define DEG2RAD 0.017453292F
 
@@ -19,6 +22,46 @@ namespace util::culling {
         INSIDE
     };
 
+    /** @brief Centers and radii of 8 spheres in SoA layout, lane i belongs to sphere i */
+    struct Spheres {
+        alignas(32) std::array<f32, 8> x;
+        alignas(32) std::array<f32, 8> y;
+        alignas(32) std::array<f32, 8> z;
+        alignas(32) std::array<f32, 8> radius;
+    };
+
+    /** @brief Per sphere bits of a classification, spheres in neither mask intersect the frustum */
+    struct Classification {
+        u8 outside;
+        u8 inside;
+    };
+
+    class Frustum;
+
+    namespace scalar {
+        auto spheres_visible_type(const Frustum &, const Spheres &) -> Classification;
+    }
+
+    namespace avx2 {
+        auto spheres_visible_type(const Frustum &, const Spheres &) -> Classification;
+    }
+
+    /**
+     * @brief Per instruction set variants of the frustum kernels, the same way as node_kernels.
+     *        Every variant is compiled into the binary, the executing cpu decides which one is used.
+     */
+    struct Kernels {
+        cpu::Isa isa;
+
+        /** @brief Classification of 8 spheres, lane by lane equal to sphere_frustum_collision */
+        Classification (*spheres_visible_type)(const Frustum &, const Spheres &);
+    };
+
+    auto select(cpu::Isa) -> const Kernels &;
+
+    /** @brief Kernels of the best instruction set of the executing cpu, chosen once at startup */
+    extern const Kernels &kernels;
+
     class Frustum {
     public:
         Frustum() =default;
@@ -32,6 +75,7 @@ namespace util::culling {
 
         auto cube_visible_type(const glm::vec3 &point, u32 scale) const -> CollisionType;
         auto squere_visible_type(const glm::vec2 &point, u32 scale) const -> CollisionType;
+        auto spheres_visible_type(const Spheres &spheres) const -> Classification;
 
     private:
         auto sphere_frustum_collision(const glm::vec3 &point, f32 radius) const -> CollisionType;
@@ -50,6 +94,9 @@ namespace util::culling {
         f32 sphere_factor_x;
         f32 sphere_factor_y;
         f32 angle;
+
+        friend auto scalar::spheres_visible_type(const Frustum &, const Spheres &) -> Classification;
+        friend auto avx2::spheres_visible_type(const Frustum &, const Spheres &) -> Classification;
     };
 };
 
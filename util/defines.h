@@ -7,6 +7,7 @@
 
 #include <cstdint>
 #include <cmath>
+#include <array>
 
 using usize = size_t;
 using u8  = uint8_t;
@@ -27,6 +28,8 @@ using f64 = double_t;
 #define RENDER_RADIUS       16
 #define RENDER_DISTANCE     (RENDER_RADIUS * CHUNK_SIZE * 0.5F)
 #define SQRT_2              1.4142135623730951F
+#define LOD_PROJECTED_SIZE  (1.0F / 64.0F)
+#define LOD_MAX_LEVEL       3
 #define DEFAULT_WIDTH       1920
 #define DEFAULT_HEIGHT      1080
 #define CACHE_LINE_SIZE     64
@@ -56,17 +59,18 @@ using f64 = double_t;
     #define ALWAYS_INLINE inline
 #endif
 
-#ifdef __AVX2__
-#include <immintrin.h>
-    #define VERTEX __m256i
-#else
-    #define VERTEX u64
-#endif
+#define VERTEX util::Quad
 
 #define IS_POW_2(x) \
     (!((x) & ((x) - 1)))
 
 namespace util {
+
+    /** @brief The 4 packed vertices of a face, the same 32 byte unit on every instruction set */
+    struct alignas(32) Quad {
+        std::array<u64, 4> vertices;
+    };
+
     template <typename C, typename ...Args>
     inline auto push_back(C &c, Args ...args) -> void {
         (c.push_back(std::forward<Args>(args)), ...);